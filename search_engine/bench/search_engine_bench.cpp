@@ -0,0 +1,175 @@
+#include <benchmark/benchmark.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "inverted_index.h"
+#include "search_server.h"
+#include "text_normalizer.h"
+#include "corpus_generator.h"
+
+/**
+ * Бенчмарки индексации и поиска.
+ * Машиночитаемый отчёт: search_engine_bench --benchmark_format=json
+ * (или --benchmark_out=result.json --benchmark_out_format=json).
+ */
+
+namespace {
+
+// Корпус бенчмарков: тот же генератор, что у search_engine_corpus
+const CorpusGenerator &Corpus() {
+    static CorpusGenerator generator([]() {
+        CorpusOptions options;
+        options.seed = 42;
+        options.vocabulary = 20000;
+        return options;
+    }());
+    return generator;
+}
+
+std::vector<std::string> Documents(size_t count, size_t words_per_doc) {
+    std::vector<std::string> docs;
+    docs.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        docs.push_back(Corpus().Document(i, words_per_doc));
+    }
+    return docs;
+}
+
+// Запросы фиксированной длины берутся из номеров "документов" за пределами корпуса
+std::vector<std::string> Queries(size_t count, size_t terms) {
+    std::vector<std::string> queries;
+    for (size_t q = 0; q < count; q++) {
+        queries.push_back(Corpus().Document(1000000000 + q, terms));
+    }
+    return queries;
+}
+
+const size_t kWordsPerDoc = 100;
+
+size_t TotalBytes(const std::vector<std::string> &docs) {
+    size_t bytes = 0;
+    for (auto &doc : docs) {
+        bytes += doc.size();
+    }
+    return bytes;
+}
+
+/**
+ * Индекс заданного размера строится один раз и используется всеми бенчмарками поиска.
+ */
+InvertedIndex &IndexOfSize(size_t documents) {
+    static std::map<size_t, std::unique_ptr<InvertedIndex>> indexes;
+    auto &index = indexes[documents];
+    if (!index) {
+        index = std::make_unique<InvertedIndex>();
+        index->UpdateDocumentBase(Documents(documents, kWordsPerDoc));
+    }
+    return *index;
+}
+
+void BM_NormalizeWord(benchmark::State &state) {
+    const std::string word = state.range(0) == 0 ? "HelloWorld" : "ПриветМир";
+    std::string out;
+    for (auto _ : state) {
+        NormalizeWord(word, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * word.size()));
+    state.SetLabel(state.range(0) == 0 ? "latin" : "cyrillic");
+}
+BENCHMARK(BM_NormalizeWord)->Arg(0)->Arg(1);
+
+void BM_Tokenize(benchmark::State &state) {
+    std::string doc = Corpus().Document(0, static_cast<size_t>(state.range(0)));
+    std::string normalized;
+    for (auto _ : state) {
+        NormalizeWord(doc, normalized);
+        size_t tokens = 0;
+        ForEachToken(normalized, [&tokens](std::string_view) { tokens++; });
+        benchmark::DoNotOptimize(tokens);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * doc.size()));
+}
+BENCHMARK(BM_Tokenize)->Arg(100)->Arg(10000);
+
+void BM_UpdateDocumentBase(benchmark::State &state) {
+    auto docs = Documents(static_cast<size_t>(state.range(0)), kWordsPerDoc);
+    IndexOptions options;
+    options.threads = static_cast<size_t>(state.range(1));
+    for (auto _ : state) {
+        InvertedIndex idx(options);
+        idx.UpdateDocumentBase(docs);
+        benchmark::DoNotOptimize(idx.GetDocumentCount());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * docs.size()));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * TotalBytes(docs)));
+}
+BENCHMARK(BM_UpdateDocumentBase)
+    ->ArgNames({"docs", "threads"})
+    ->Args({1000, 1})->Args({10000, 1})->Args({10000, 0})->Args({100000, 0})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+void BM_GetWordCount(benchmark::State &state) {
+    InvertedIndex &idx = IndexOfSize(10000);
+    // Ранг слова в распределении: 0 - самое частое
+    const std::string word = Corpus().Word(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        auto entries = idx.GetWordCount(word);
+        benchmark::DoNotOptimize(entries.data());
+    }
+    state.SetLabel("postings=" + std::to_string(idx.GetPostings(word).size));
+}
+BENCHMARK(BM_GetWordCount)->ArgName("rank")->Arg(0)->Arg(100)->Arg(10000);
+
+void BM_Search(benchmark::State &state) {
+    InvertedIndex &idx = IndexOfSize(static_cast<size_t>(state.range(0)));
+    SearchServer srv(idx, 5);
+    // Набор запросов из query_terms слов, выбранных по распределению корпуса
+    auto queries = Queries(64, static_cast<size_t>(state.range(1)));
+    size_t i = 0;
+    for (auto _ : state) {
+        auto result = srv.SearchQuery(queries[i++ % queries.size()]);
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_Search)
+    ->ArgNames({"docs", "query_terms"})
+    ->ArgsProduct({{1000, 10000, 100000}, {1, 3, 8}})
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_SearchMode(benchmark::State &state) {
+    InvertedIndex &idx = IndexOfSize(100000);
+    SearchServer srv(idx, 5);
+    // Два самых частых слова и одно редкое: в режиме And время задаёт редкое
+    const std::string query = Corpus().Word(0) + " " + Corpus().Word(1) + " " + Corpus().Word(5000);
+    QueryOptions options;
+    options.mode = state.range(0) == 0 ? QueryMode::Or : QueryMode::And;
+    size_t postings = 0;
+    for (auto _ : state) {
+        auto result = srv.Search(query, options);
+        postings = result.postings_scored;
+        benchmark::DoNotOptimize(result.items.data());
+    }
+    state.SetLabel(std::string(state.range(0) == 0 ? "or" : "and") + " postings=" + std::to_string(postings));
+}
+BENCHMARK(BM_SearchMode)->ArgName("and")->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+void BM_SearchBatch(benchmark::State &state) {
+    InvertedIndex &idx = IndexOfSize(10000);
+    SearchServer srv(idx, 5);
+    auto queries = Queries(1000, 3);
+    for (auto _ : state) {
+        auto result = srv.search(queries);
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * queries.size()));
+}
+BENCHMARK(BM_SearchBatch)->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,48 @@
+#ifndef ANSWERS_READER_H
+#define ANSWERS_READER_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+/**
+ * Одна запись двоичного файла ответов.
+ */
+struct AnswerRecord {
+    uint32_t query_id; // номер запроса с нуля (request001 -> 0)
+    uint32_t doc_id;
+    float rank;
+    bool operator==(const AnswerRecord &other) const;
+};
+
+/**
+ * Чтение answers.bin, записанного AnswersBinaryWriter.
+ * Записи идут по возрастанию query_id, внутри запроса - по убыванию rank.
+ */
+class BinaryAnswersReader {
+public:
+    /**
+     * Открывает файл и проверяет заголовок; при ошибке бросает std::runtime_error.
+     */
+    explicit BinaryAnswersReader(const std::string &path);
+
+    // Количество запросов (включая запросы без результатов)
+    uint32_t QueryCount() const { return _query_count; }
+
+    /**
+     * Читает следующую запись; false, если записи закончились.
+     */
+    bool Next(AnswerRecord &record);
+
+    /**
+     * Читает файл целиком и группирует записи по запросам.
+     */
+    static std::vector<std::vector<AnswerRecord>> ReadAll(const std::string &path);
+
+private:
+    std::ifstream _in;
+    uint32_t _query_count = 0;
+};
+
+#endif // ANSWERS_READER_H
@@ -0,0 +1,106 @@
+#ifndef ANSWERS_WRITER_H
+#define ANSWERS_WRITER_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Общий интерфейс потоковой записи ответов.
+ */
+class AnswersWriter {
+public:
+    virtual ~AnswersWriter() = default;
+
+    /**
+     * Записывает ответ на очередной запрос (запросы нумеруются по порядку вызовов).
+     */
+    virtual void Write(const std::vector<std::pair<int, float>> &answer) = 0;
+
+    /**
+     * Завершает файл и сбрасывает буфер на диск. Ответы пишутся во временный
+     * файл и заменяют прежний только здесь; если Finish не вызван
+     * (ошибка посреди прогона), деструктор удаляет временный файл.
+     */
+    virtual void Finish() = 0;
+};
+
+/**
+ * Потоковая запись answers.json: каждый ответ сериализуется сразу
+ * в буфер вывода, без построения DOM всего файла.
+ * Формат совпадает с прежним ConverterJSON::putAnswers (nlohmann::json):
+ * в режиме pretty - отступ 4 пробела, иначе - компактная запись.
+ */
+class AnswersJsonWriter : public AnswersWriter {
+public:
+    explicit AnswersJsonWriter(const std::string &path, bool pretty = true);
+    ~AnswersJsonWriter() override;
+
+    AnswersJsonWriter(const AnswersJsonWriter &) = delete;
+    AnswersJsonWriter &operator=(const AnswersJsonWriter &) = delete;
+
+    void Write(const std::vector<std::pair<int, float>> &answer) override;
+
+    /**
+     * Закрывает JSON-объект, сбрасывает буфер на диск и переименовывает
+     * временный файл в path. Без вызова Finish прежний файл не меняется.
+     */
+    void Finish() override;
+
+    /**
+     * Идентификатор запроса по его порядковому номеру: request001, request002, ...
+     */
+    static std::string RequestId(size_t index);
+
+private:
+    void NewLine(int depth);
+    void FlushIfFull();
+    void Flush();
+
+    std::string _path;
+    std::string _temp_path;
+    std::ofstream _out;
+    std::string _buffer;
+    bool _pretty;
+    bool _finished = false;
+    size_t _count = 0;
+};
+
+/**
+ * Компактная двоичная запись ответов (answers.bin).
+ * Заголовок: "SEAB", версия, размер записи, количество запросов (uint32 LE).
+ * Далее записи фиксированной длины 12 байт: номер запроса (uint32, с нуля),
+ * doc_id (uint32) и rank (float32), все в little-endian.
+ * Запрос без результатов не имеет записей. Читать - BinaryAnswersReader.
+ */
+class AnswersBinaryWriter : public AnswersWriter {
+public:
+    explicit AnswersBinaryWriter(const std::string &path);
+    ~AnswersBinaryWriter() override;
+
+    AnswersBinaryWriter(const AnswersBinaryWriter &) = delete;
+    AnswersBinaryWriter &operator=(const AnswersBinaryWriter &) = delete;
+
+    void Write(const std::vector<std::pair<int, float>> &answer) override;
+
+    /**
+     * Дописывает в заголовок количество запросов, закрывает файл
+     * и переименовывает временный файл в path.
+     */
+    void Finish() override;
+
+private:
+    void Flush();
+
+    std::string _path;
+    std::string _temp_path;
+    std::ofstream _out;
+    std::string _buffer;
+    bool _finished = false;
+    uint32_t _count = 0;
+};
+
+#endif // ANSWERS_WRITER_H
@@ -0,0 +1,153 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <cstddef>
+
+/**
+ * Ожидание с нарастающей паузой: сначала активное ожидание,
+ * затем yield, затем короткий сон.
+ */
+class Backoff {
+public:
+    void Pause() {
+        if (_step < 64) {
+            _step++;
+        } else if (_step < 128) {
+            _step++;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    void Reset() { _step = 0; }
+
+private:
+    int _step = 0;
+};
+
+/**
+ * Ограниченная lock-free очередь для нескольких производителей
+ * и потребителей (кольцевой буфер с порядковыми номерами ячеек).
+ * Push блокируется, пока очередь заполнена - это и есть обратное давление.
+ * После Close() Push возвращает false, а Pop дочитывает оставшееся.
+ * Close() вызывается, когда производители закончили работу (или при аварийной остановке).
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        _mask = size - 1;
+        _cells = std::make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; i++) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    /**
+     * Добавляет элемент без ожидания; false, если очередь заполнена.
+     */
+    bool TryPush(T &value) {
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = _cells[pos & _mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Извлекает элемент без ожидания; false, если очередь пуста.
+     */
+    bool TryPop(T &value) {
+        size_t pos = _head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = _cells[pos & _mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    cell.sequence.store(pos + _mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Добавляет элемент, ожидая свободного места; false, если очередь закрыта.
+     */
+    bool Push(T value) {
+        Backoff backoff;
+        while (!_closed.load(std::memory_order_acquire)) {
+            if (TryPush(value)) {
+                return true;
+            }
+            backoff.Pause();
+        }
+        return false;
+    }
+
+    /**
+     * Извлекает элемент, ожидая его появления; false, если очередь
+     * закрыта и пуста.
+     */
+    bool Pop(T &value) {
+        Backoff backoff;
+        for (;;) {
+            if (TryPop(value)) {
+                return true;
+            }
+            if (_closed.load(std::memory_order_acquire)) {
+                return TryPop(value);
+            }
+            backoff.Pause();
+        }
+    }
+
+    void Close() { _closed.store(true, std::memory_order_release); }
+
+    bool Closed() const { return _closed.load(std::memory_order_acquire); }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> _cells;
+    size_t _mask = 0;
+    alignas(64) std::atomic<size_t> _tail{0};
+    alignas(64) std::atomic<size_t> _head{0};
+    std::atomic<bool> _closed{false};
+};
+
+#endif // BOUNDED_QUEUE_H
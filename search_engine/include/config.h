@@ -0,0 +1,72 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include "posting_list.h"
+#include "document_store.h"
+#include "search_server.h"
+
+/**
+ * Формат файла ответов.
+ */
+enum class AnswersFormat {
+    JsonPretty,  // answers.json с отступами
+    JsonCompact, // answers.json без отступов
+    Binary       // answers.bin с записями фиксированной длины
+};
+
+/**
+ * Настройки из config.json. Загружаются и проверяются один раз,
+ * затем передаются всем компонентам.
+ */
+struct Config {
+    std::string name;
+    std::string version;
+    int max_responses = 5;
+    std::vector<std::string> files;
+
+    // Параметры производительности (необязательные поля секции "config")
+
+    // Потоки индексации и поиска (0 - по числу ядер)
+    size_t threads = 0;
+    // Бюджет памяти индексации в МБ; если задан, документы читаются из файлов
+    // по одному и индекс строится с выгрузкой частей на диск, а итоговые
+    // списки вхождений отображаются в память из временного файла
+    size_t memory_budget_mb = 0;
+    // Каталог для временных файлов индексации
+    std::string temp_dir;
+    // Строить позиционный индекс для фразовых запросов (несовместимо с memory_budget_mb)
+    bool positions = false;
+    // Разрядность счётчиков в индексе: 16 или 32
+    CountWidth count_width = CountWidth::Bits32;
+    // Режим запросов по умолчанию: "or" или "and" (все слова)
+    QueryMode query_mode = QueryMode::Or;
+    // Ёмкость очередей конвейера запросов
+    size_t queue_capacity = 1024;
+    // Формат файла ответов
+    AnswersFormat answers_format = AnswersFormat::JsonPretty;
+    // Срок одного запроса в мс (0 - без срока)
+    size_t query_timeout_ms = 0;
+    // Сколько вхождений может просмотреть один запрос (0 - без ограничения)
+    size_t query_max_postings = 0;
+    // Сколько потоков сервера могут выполнять пакетные запросы (0 - половина)
+    size_t batch_threads = 0;
+    // Предел суммарной стоимости (вхождений) ожидающих запросов сервера; 0 - без предела
+    size_t max_queued_postings = 0;
+    // Файл хранилища текстов документов (пусто - не создаётся)
+    std::string document_store;
+    // Сжатие блоков хранилища и размер несжатого блока в КБ
+    DocumentCodec document_codec = DocumentCodec::Lz;
+    size_t document_block_kb = 64;
+    // Сколько распакованных блоков хранилища держать в кэше
+    size_t document_cache_blocks = 64;
+
+    /**
+     * Читает и проверяет config.json. При ошибке бросает std::runtime_error.
+     */
+    static Config Load(const std::string &path = "config.json");
+};
+
+#endif // CONFIG_H
@@ -3,6 +3,12 @@
 
 #include <vector>
 #include <string>
+#include <istream>
+#include <functional>
+#include <optional>
+#include <memory>
+#include "config.h"
+#include "answers_writer.h"
 
 /**
  * Класс для работы с JSON-файлами.
@@ -11,6 +17,17 @@ class ConverterJSON {
 public:
     ConverterJSON() = default;
 
+    /**
+     * Использует уже загруженные настройки вместо чтения config.json.
+     */
+    explicit ConverterJSON(const Config &config);
+
+    /**
+     * Возвращает настройки; config.json читается и проверяется только при
+     * первом обращении, дальше используется сохранённый Config.
+     */
+    const Config &GetConfig();
+
     /**
      * Считывает и возвращает содержимое документов, перечисленных в config.json
      */
@@ -26,10 +43,31 @@ public:
      */
     std::vector<std::string> GetRequests();
 
+    /**
+     * Потоково (SAX) читает requests.json и передаёт каждый запрос в on_request
+     * сразу по мере разбора, не строя DOM всего файла.
+     */
+    void StreamRequests(const std::function<void(std::string &&)> &on_request);
+
+    /**
+     * То же для произвольного потока с содержимым requests.json.
+     */
+    void StreamRequests(std::istream &in, const std::function<void(std::string &&)> &on_request);
+
     /**
      * Записывает результаты поиска в answers.json
      */
     void putAnswers(const std::vector<std::vector<std::pair<int, float>>> &answers);
+
+    /**
+     * Создаёт потоковую запись ответов в формате из настроек:
+     * answers.json (pretty/compact) или answers.bin (binary).
+     * Если настройки не загружены, используется answers.json с отступами.
+     */
+    std::unique_ptr<AnswersWriter> MakeAnswersWriter();
+
+private:
+    std::optional<Config> config;
 };
 
 #endif // CONVERTER_JSON_H
@@ -0,0 +1,85 @@
+#ifndef CORPUS_GENERATOR_H
+#define CORPUS_GENERATOR_H
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Параметры синтетического корпуса и журнала запросов.
+ */
+struct CorpusOptions {
+    uint64_t seed = 1;
+    // Размер словаря и показатель распределения Ципфа частот слов
+    size_t vocabulary = 50000;
+    double zipf_exponent = 1.0;
+    // Доля кириллических слов в словаре
+    double cyrillic_share = 0.5;
+    // Вероятность, что вхождение слова написано с заглавной буквы
+    double capitalized_share = 0.1;
+    // Длина документа в словах - логнормальное распределение со средним mean
+    double doc_length_mean = 200;
+    double doc_length_sigma = 0.8;
+    size_t doc_length_max = 100000;
+    // Число слов в запросе: 1 + распределение Пуассона, не больше max
+    double query_terms_mean = 2.5;
+    size_t query_terms_max = 10;
+    // Доля запросов, повторяющих один из предыдущих
+    double query_repeat_rate = 0.3;
+};
+
+/**
+ * Детерминированный генератор корпуса: одинаковые параметры и seed дают
+ * одинаковые документы и запросы на любой платформе (используются только
+ * std::mt19937_64 и собственные преобразования распределений).
+ * Частые слова короче редких, как в естественном языке.
+ * Документ с номером i генерируется независимо от остальных,
+ * поэтому корпус можно строить параллельно.
+ */
+class CorpusGenerator {
+public:
+    explicit CorpusGenerator(const CorpusOptions &options = {});
+
+    // Слово словаря по рангу частоты (0 - самое частое), в нижнем регистре
+    const std::string &Word(size_t rank) const { return _words[rank]; }
+
+    size_t VocabularySize() const { return _words.size(); }
+
+    /**
+     * Текст документа с номером index; длина берётся из распределения.
+     */
+    std::string Document(uint64_t index) const;
+
+    /**
+     * Текст документа с номером index из заданного числа слов.
+     */
+    std::string Document(uint64_t index, size_t words) const;
+
+    /**
+     * Журнал из count запросов с учётом доли повторов.
+     */
+    std::vector<std::string> Queries(size_t count) const;
+
+    const CorpusOptions &Options() const { return _options; }
+
+private:
+    size_t SampleRank(std::mt19937_64 &rng) const;
+    void AppendWords(std::mt19937_64 &rng, size_t count, std::string &out) const;
+
+    CorpusOptions _options;
+    std::vector<std::string> _words;
+    std::vector<std::string> _capitalized;
+    std::vector<double> _cdf;
+};
+
+/**
+ * Записывает корпус в каталог dir в формате программы:
+ * dir/resources/NNNNN/NNNNNNNNN.txt (по 1000 файлов в подкаталоге),
+ * dir/config.json со списком файлов и dir/requests.json.
+ */
+void WriteCorpus(const std::string &dir, const CorpusGenerator &generator,
+                 size_t documents, size_t queries, size_t threads = 0);
+
+#endif // CORPUS_GENERATOR_H
@@ -0,0 +1,162 @@
+#ifndef DOCUMENT_STORE_H
+#define DOCUMENT_STORE_H
+
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <list>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "mapped_file.h"
+
+/**
+ * Сжатие блоков хранилища документов.
+ */
+enum class DocumentCodec {
+    None, // блоки хранятся как есть
+    Lz    // встроенный LZ77-кодек в формате последовательностей LZ4
+};
+
+/**
+ * Сжимает данные встроенным кодеком: последовательности "литералы + совпадение"
+ * с 16-битным смещением и минимальной длиной совпадения 4 байта.
+ */
+std::string LzCompress(std::string_view input);
+
+/**
+ * Распаковывает результат LzCompress; raw_size - исходный размер.
+ * При повреждённых данных бросает std::runtime_error.
+ */
+std::string LzDecompress(std::string_view input, size_t raw_size);
+
+/**
+ * Параметры записи хранилища документов.
+ */
+struct DocumentStoreOptions {
+    DocumentCodec codec = DocumentCodec::Lz;
+    // Размер несжатого блока; документ может занимать несколько блоков
+    size_t block_size = 64 * 1024;
+};
+
+/**
+ * Запись хранилища документов. Тексты документов подряд образуют поток,
+ * который режется на блоки фиксированного несжатого размера, и каждый блок
+ * сжимается отдельно. Формат файла (little-endian):
+ *   заголовок: "SEDS", версия (uint32), кодек (uint32), размер блока (uint32);
+ *   блоки: байт метода (0 - без сжатия, 1 - Lz) и данные;
+ *   смещения документов в несжатом потоке: uint64 x (документов + 1);
+ *   смещения блоков в файле: uint64 x (блоков + 1);
+ *   концевик: число документов, число блоков, смещение таблиц (uint64) и "SEDS".
+ * Блок, который не сжимается, хранится как есть.
+ */
+class DocumentStoreWriter {
+public:
+    explicit DocumentStoreWriter(const std::string &path, const DocumentStoreOptions &options = {});
+    ~DocumentStoreWriter();
+
+    DocumentStoreWriter(const DocumentStoreWriter &) = delete;
+    DocumentStoreWriter &operator=(const DocumentStoreWriter &) = delete;
+
+    /**
+     * Добавляет документ; его номер - количество добавленных ранее.
+     */
+    void Add(std::string_view text);
+
+    size_t Count() const { return _doc_offsets.size() - 1; }
+
+    /**
+     * Дописывает последний блок и таблицы и переименовывает временный файл
+     * (path + ".tmp") в path. Без вызова Finish (ошибка посреди записи)
+     * деструктор удаляет временный файл, а прежнее хранилище не меняется.
+     */
+    void Finish();
+
+private:
+    void FlushBlock(std::string_view raw);
+
+    std::string _path;
+    std::string _temp_path;
+    std::ofstream _out;
+    DocumentStoreOptions _options;
+    std::string _block;
+    std::string _compressed;
+    std::vector<uint64_t> _doc_offsets{0};
+    std::vector<uint64_t> _block_offsets;
+    uint64_t _file_offset = 0;
+    bool _finished = false;
+};
+
+/**
+ * Хранилище документов только для чтения. Файл отображается в память (mmap;
+ * на платформах без mmap читается целиком), поэтому открытие не зависит от
+ * размера корпуса. Номер блока документа вычисляется по таблице смещений за O(1).
+ * Распакованные блоки хранятся в LRU-кэше. Потокобезопасно.
+ */
+class DocumentStore {
+public:
+    /**
+     * Открывает файл и проверяет заголовок и таблицы; при ошибке
+     * бросает std::runtime_error. cache_blocks - ёмкость кэша блоков (0 - без кэша).
+     */
+    explicit DocumentStore(const std::string &path, size_t cache_blocks = 64);
+
+    DocumentStore(const DocumentStore &) = delete;
+    DocumentStore &operator=(const DocumentStore &) = delete;
+
+    // Количество документов
+    size_t Size() const { return _doc_count; }
+
+    /**
+     * Текст документа; при doc_id >= Size() бросает std::out_of_range.
+     */
+    std::string Get(size_t doc_id) const;
+
+    /**
+     * Не больше max_bytes байт текста документа, начиная с начала
+     * (распаковываются только нужные блоки).
+     */
+    std::string Prefix(size_t doc_id, size_t max_bytes) const;
+
+    // Размер файла и несжатого текста в байтах
+    size_t FileBytes() const { return _size; }
+    uint64_t RawBytes() const { return DocOffset(_doc_count); }
+
+    uint64_t CacheHits() const { return _hits.load(std::memory_order_relaxed); }
+    uint64_t CacheMisses() const { return _misses.load(std::memory_order_relaxed); }
+
+private:
+    using Block = std::shared_ptr<const std::string>;
+
+    uint64_t DocOffset(size_t doc_id) const;
+    // Границы документа в несжатом потоке, с проверкой записи таблицы
+    std::pair<uint64_t, uint64_t> DocRange(size_t doc_id) const;
+    uint64_t BlockOffset(size_t block) const;
+    std::string Read(uint64_t begin, uint64_t end) const;
+    Block LoadBlock(size_t block) const;
+    Block DecodeBlock(size_t block) const;
+
+    MappedFile _file;
+    const char *_data = nullptr;
+    size_t _size = 0;
+
+    uint32_t _block_size = 0;
+    size_t _doc_count = 0;
+    size_t _block_count = 0;
+    const char *_doc_table = nullptr;
+    const char *_block_table = nullptr;
+
+    size_t _cache_capacity;
+    mutable std::mutex _mtx;
+    mutable std::list<std::pair<size_t, Block>> _lru; // свежие в начале
+    mutable std::unordered_map<size_t, std::list<std::pair<size_t, Block>>::iterator> _cache;
+    mutable std::atomic<uint64_t> _hits{0};
+    mutable std::atomic<uint64_t> _misses{0};
+};
+
+#endif // DOCUMENT_STORE_H
@@ -0,0 +1,38 @@
+#ifndef EXPLAIN_JSON_H
+#define EXPLAIN_JSON_H
+
+#include <nlohmann/json.hpp>
+#include "search_server.h"
+
+/**
+ * Трассировка запроса в JSON для ответов серверов (времена - в микросекундах):
+ * {"total_us": 12.5,
+ *  "terms": [{"term": "milk", "posting_length": 3, "postings_scored": 3, "bytes_decoded": 24,
+ *             "position_bytes": 0, "blocks_scanned": 1, "blocks_skipped": 0, "time_us": 1.2}],
+ *  "thresholds": [{"term": "milk", "candidates": 3, "threshold": 1}]}
+ * Слова копируются из запроса как есть и могут быть некорректным UTF-8,
+ * поэтому результат нужно сериализовать с json::error_handler_t::replace.
+ */
+inline nlohmann::json ExplainToJson(const QueryExplain &explain) {
+    auto micros = [](std::chrono::nanoseconds time) { return static_cast<double>(time.count()) / 1000.0; };
+    nlohmann::json terms = nlohmann::json::array();
+    for (const auto &term : explain.terms) {
+        terms.push_back({{"term", term.term},
+                         {"posting_length", term.posting_length},
+                         {"postings_scored", term.postings_scored},
+                         {"bytes_decoded", term.bytes_decoded},
+                         {"position_bytes", term.position_bytes},
+                         {"blocks_scanned", term.blocks_scanned},
+                         {"blocks_skipped", term.blocks_skipped},
+                         {"time_us", micros(term.time)}});
+    }
+    nlohmann::json thresholds = nlohmann::json::array();
+    for (const auto &step : explain.thresholds) {
+        thresholds.push_back({{"term", explain.terms[step.term].term},
+                              {"candidates", step.candidates},
+                              {"threshold", step.threshold}});
+    }
+    return {{"total_us", micros(explain.total_time)}, {"terms", terms}, {"thresholds", thresholds}};
+}
+
+#endif // EXPLAIN_JSON_H
@@ -0,0 +1,138 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "search_server.h"
+#include "socket_utils.h"
+#include "query_scheduler.h"
+#include "document_store.h"
+
+/**
+ * Параметры HTTP-сервера.
+ */
+struct HttpServerOptions {
+    // Потоки, очереди и допуск запросов; отклонённые запросы сразу получают 503
+    SchedulerOptions scheduler;
+    // Максимум одновременных соединений; лишние получают 503 и закрываются
+    size_t max_connections = 1024;
+    // Длина очереди принятия соединений ядра
+    int backlog = 128;
+    // Максимальный размер заголовков одного запроса
+    size_t max_request_size = 16 * 1024;
+    // Сколько запросов одного соединения может ожидать ответа (конвейер)
+    size_t max_pipeline = 32;
+    // Хранилище текстов для GET /document?id=N (nullptr - не обслуживается)
+    const DocumentStore *documents = nullptr;
+};
+
+/**
+ * Встроенный HTTP/1.1-сервер: GET /search?q=...&k=...
+ * Один поток обслуживает все соединения через epoll, поиск выполняется
+ * через QueryScheduler (параметр priority=batch - пакетный класс). Поддерживаются keep-alive и конвейерные запросы
+ * (ответы отправляются строго в порядке запросов).
+ * Тело ответа - JSON вида {"result": true, "relevance": [{"docid": 0, "rank": 1.0}]};
+ * необязательный параметр timeout_ms задаёт срок запроса (не дольше срока
+ * SearchServer по умолчанию), неполный ответ
+ * помечается полем "partial": true. С параметром explain=1 в ответ
+ * добавляется трассировка запроса (см. ExplainToJson), mode=and оставляет
+ * только документы со всеми словами запроса.
+ * GET /metrics отдаёт Metrics() в текстовом формате Prometheus
+ * (GET /metrics?format=json - в JSON). GET /document?id=N возвращает текст
+ * документа из options.documents: {"docid": N, "text": "..."}.
+ * Работает только в Linux (epoll); на других платформах Run() бросает исключение.
+ */
+class HttpServer {
+public:
+    explicit HttpServer(const SearchServer &server, const HttpServerOptions &options = {});
+    ~HttpServer();
+
+    HttpServer(const HttpServer &) = delete;
+    HttpServer &operator=(const HttpServer &) = delete;
+
+    /**
+     * Открывает сокет для прослушивания.
+     */
+    void Listen(const SocketAddress &address);
+
+    // Фактический TCP-порт (полезно при port = 0)
+    uint16_t Port() const { return _port; }
+
+    /**
+     * Цикл обработки событий; возвращается после Stop().
+     */
+    void Run();
+
+    /**
+     * Останавливает цикл. Можно вызывать из другого потока.
+     */
+    void Stop();
+
+    /**
+     * Декодирует компонент URL (%XX и '+' как пробел).
+     */
+    static std::string UrlDecode(std::string_view text);
+
+private:
+    struct Pending {
+        std::string response;
+        bool ready = false;
+        bool close = false;
+    };
+
+    struct Connection {
+        int fd = -1;
+        std::string input;
+        std::string output;
+        size_t output_pos = 0;
+        std::deque<Pending> pending;  // ответы в порядке запросов
+        uint64_t first_seq = 0;       // номер запроса pending.front()
+        uint64_t next_seq = 0;
+        bool closing = false;         // новых запросов не читаем
+        uint32_t events = 0;          // текущая подписка epoll
+    };
+
+    struct Completion {
+        uint64_t connection_id;
+        uint64_t seq;
+        std::string response;
+        bool close;
+    };
+
+    void Accept();
+    void Read(uint64_t id, Connection &connection);
+    void ParseRequests(uint64_t id, Connection &connection);
+    void Reject(Connection &connection, int status, const std::string &message);
+    void Respond(Connection &connection, uint64_t seq, std::string response, bool close);
+    void Flush(uint64_t id, Connection &connection);
+    void UpdateEvents(uint64_t id, Connection &connection);
+    void CloseConnection(uint64_t id);
+    void ProcessCompletions();
+    void Wake();
+
+    const SearchServer &_server;
+    HttpServerOptions _options;
+    int _listen_fd = -1;
+    int _epoll_fd = -1;
+    int _wake_fd = -1;
+    std::string _unix_path;
+    uint16_t _port = 0;
+    std::atomic<bool> _stopping{false};
+    std::unordered_map<uint64_t, std::unique_ptr<Connection>> _connections;
+    uint64_t _next_id;
+
+    std::mutex _completions_mtx;
+    std::vector<Completion> _completions;
+
+    QueryScheduler _scheduler;
+};
+
+#endif // HTTP_SERVER_H
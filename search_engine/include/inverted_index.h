@@ -3,11 +3,18 @@
 
 #include <vector>
 #include <string>
-#include <map>
+#include <memory>
 #include <cstddef>
+#include "term_dictionary.h"
+#include "scratch_memory.h"
+#include "posting_list.h"
+#include "position_list.h"
+#include "mapped_file.h"
 
 /**
  * Структура для хранения doc_id и частоты слова (count).
+ * Внутри индекса вхождения хранятся компактно (PostingList),
+ * Entry - совместимое представление для GetWordCount.
  */
 struct Entry {
     size_t doc_id;
@@ -15,26 +22,161 @@ struct Entry {
     bool operator==(const Entry &other) const;
 };
 
+/**
+ * Параметры индексации.
+ */
+struct IndexOptions {
+    // Количество потоков индексации (0 - по числу ядер)
+    size_t threads = 0;
+    // Разрядность счётчиков в списках вхождений
+    CountWidth count_width = CountWidth::Bits32;
+    // Бюджет памяти (байт) под буферы вхождений при индексации из файлов.
+    // Списки вхождений итогового индекса сливаются в файл и отображаются
+    // в память; в куче остаются словарь и таблица списков
+    size_t memory_budget = 256 * 1024 * 1024;
+    // Каталог для временных файлов (пусто - системный временный каталог)
+    std::string temp_dir;
+    // Сохранять ли тексты документов (GetDocument). По умолчанию индекс
+    // хранит только вхождения, и его память не зависит от объёма текста
+    bool keep_documents = false;
+    // Строить позиционный индекс (номера слов в документах) для фраз.
+    // Только для UpdateDocumentBase; позиции хранятся отдельно от вхождений
+    bool positions = false;
+};
+
+/**
+ * Статистика временной памяти потоков индексации за последний вызов
+ * UpdateDocumentBase (суммарно по всем потокам).
+ */
+struct IndexingMemoryStats {
+    size_t documents = 0;           // обработано документов
+    MemoryResourceStats scratch;    // запросы к аренам потоков
+    MemoryResourceStats heap;       // обращения арен к системному выделителю
+    size_t peak_document_bytes = 0; // максимум временной памяти на один документ
+    size_t spilled_runs = 0;        // частей индекса, сброшенных на диск
+    size_t spilled_bytes = 0;       // суммарный размер этих частей
+};
+
+/**
+ * Память, занятая списками вхождений одного термина.
+ */
+struct TermMemory {
+    std::string term;
+    size_t postings = 0;  // длина списка
+    size_t bytes = 0;     // байт doc_id и счётчиков
+};
+
+/**
+ * Память индекса по структурам, в байтах. Учитывается то, что индекс
+ * запросил у выделителя; служебные заголовки самого malloc не входят.
+ * "Запас" - выделенная, но не занятая ёмкость векторов, строк и блоков арены.
+ */
+struct IndexMemoryReport {
+    size_t dictionary_keys = 0;       // строки терминов в арене
+    size_t dictionary_table = 0;      // массив терминов и хеш-таблица
+    size_t posting_payload = 0;       // doc_id и счётчики
+    size_t posting_mapped = 0;        // doc_id и счётчики в отображённом файле (не входят в Total)
+    size_t posting_headers = 0;       // объекты PostingList и массив списков
+    size_t position_payload = 0;      // позиции и таблицы пропусков
+    size_t position_headers = 0;      // объекты PositionList и массив списков
+    size_t stored_documents = 0;      // текст сохранённых документов в куче
+    size_t stored_headers = 0;        // массив std::string (короткие тексты - внутри него)
+    size_t allocator_overhead = 0;    // запас ёмкости и незанятые хвосты арены
+    std::vector<TermMemory> largest_terms; // самые объёмные термины по убыванию
+
+    size_t Total() const {
+        return dictionary_keys + dictionary_table + posting_payload + posting_headers +
+               position_payload + position_headers + stored_documents + stored_headers + allocator_overhead;
+    }
+};
+
 /**
  * Класс для многопоточной индексации текстовых документов.
  */
 class InvertedIndex {
 public:
     InvertedIndex() = default;
+    explicit InvertedIndex(const IndexOptions &options);
 
     /**
      * Обновляет или заполняет базу документов.
      */
     void UpdateDocumentBase(const std::vector<std::string> &input_docs);
 
+    /**
+     * Индексирует документы, читая файлы по одному, без загрузки всего корпуса.
+     * Вхождения копятся в памяти в пределах options.memory_budget, затем
+     * сбрасываются на диск отсортированными частями. Части сливаются потоком
+     * во временный файл списков вхождений, который отображается в память
+     * (mmap) и удаляется с диска сразу после отображения. Отсутствующие
+     * файлы пропускаются, как в ConverterJSON::GetTextDocuments.
+     * Пиковая память в куче - бюджет плюс текст самого большого документа
+     * на поток, а после слияния - словарь и по PostingsView на термин.
+     */
+    void UpdateDocumentBaseFromFiles(const std::vector<std::string> &paths);
+
     /**
      * Возвращает список Entry для заданного слова.
      */
     std::vector<Entry> GetWordCount(const std::string &word) const;
 
+    /**
+     * Возвращает список вхождений слова без копирования (массивы doc_id
+     * и счётчиков). Представление валидно до следующего UpdateDocumentBase.
+     */
+    PostingsView GetPostings(const std::string &word) const;
+
+    /**
+     * Позиции слова: i-я запись соответствует i-му вхождению GetPostings.
+     * Пусто, если индекс строился без options.positions или слова нет.
+     */
+    PositionsView GetPositions(const std::string &word) const;
+
+    // Построен ли позиционный индекс
+    bool HasPositions() const { return options.positions; }
+
+    /**
+     * Количество проиндексированных документов.
+     */
+    size_t GetDocumentCount() const { return document_count; }
+
+    /**
+     * Текст документа, если индекс строился с keep_documents и из строк
+     * (UpdateDocumentBase). Иначе бросает std::logic_error.
+     */
+    const std::string &GetDocument(size_t doc_id) const;
+
+    /**
+     * Возвращает статистику временной памяти последней индексации.
+     */
+    const IndexingMemoryStats &GetIndexingMemoryStats() const { return memory_stats; }
+
+    /**
+     * Подсчитывает память, занятую индексом, и top_terms самых объёмных терминов.
+     * Обходит все списки вхождений, поэтому предназначен для диагностики.
+     */
+    IndexMemoryReport GetMemoryReport(size_t top_terms = 10) const;
+
 private:
+    // Публикует в Metrics() объём и скорость последней индексации
+    void PublishMetrics(double seconds) const;
+    // Список вхождений термина - из памяти или из отображённого файла
+    PostingsView TermPostings(uint32_t term_id) const;
+
+    IndexOptions options;
+    IndexingMemoryStats memory_stats;
+    // Тексты документов, только при options.keep_documents
     std::vector<std::string> docs;
-    std::map<std::string, std::vector<Entry>> freq_dictionary;
+    size_t document_count = 0;
+    TermDictionary dictionary;
+    // Списки вхождений, индекс - идентификатор термина из dictionary
+    std::vector<PostingList> postings;
+    // После UpdateDocumentBaseFromFiles списки лежат в отображённом файле,
+    // а postings пуст; представления указывают внутрь posting_file
+    std::shared_ptr<const MappedFile> posting_file;
+    std::vector<PostingsView> mapped_postings;
+    // Позиции (только при options.positions), параллельно postings
+    std::vector<PositionList> positions;
 };
 
 #endif // INVERTED_INDEX_H
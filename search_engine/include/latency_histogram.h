@@ -0,0 +1,82 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Лог-линейные корзины: значения меньше 2^sub_bucket_bits попадают в свою
+ * корзину, остальные - с относительной погрешностью до 2^(1 - sub_bucket_bits).
+ */
+size_t LogLinearBucketIndex(uint64_t value, int sub_bucket_bits);
+uint64_t LogLinearBucketUpperBound(size_t index, int sub_bucket_bits);
+
+// Число корзин, покрывающих весь диапазон uint64
+inline size_t LogLinearBucketCount(int sub_bucket_bits) {
+    return LogLinearBucketIndex(UINT64_MAX, sub_bucket_bits) + 1;
+}
+
+/**
+ * Лог-линейная гистограмма задержек (в духе HdrHistogram): значения
+ * меньше 2^kSubBucketBits хранятся точно, остальные - с относительной
+ * погрешностью не больше 2^(1 - kSubBucketBits), то есть ~1.6%.
+ * Память постоянная (~58 КБ) при любом диапазоне uint64.
+ * Не потокобезопасна: у каждого потока своя гистограмма, потом Merge.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 7;
+
+    LatencyHistogram();
+
+    void Record(uint64_t value);
+
+    /**
+     * Записывает значение с поправкой на скоординированное упущение:
+     * если замер длился дольше ожидаемого интервала между запросами,
+     * добавляются значения, которые получили бы запросы, не отправленные
+     * за это время (value - interval, value - 2 * interval, ...).
+     */
+    void RecordCorrected(uint64_t value, uint64_t expected_interval);
+
+    void Merge(const LatencyHistogram &other);
+
+    void Clear();
+
+    uint64_t Count() const { return _count; }
+    uint64_t Min() const { return _count ? _min : 0; }
+    uint64_t Max() const { return _max; }
+    double Mean() const;
+
+    /**
+     * Значение, не меньше которого percentile процентов замеров (0..100).
+     * Возвращается верхняя граница корзины, но не больше Max().
+     */
+    uint64_t ValueAtPercentile(double percentile) const;
+
+    /**
+     * Непустые корзины: верхняя граница и число значений. Для экспорта
+     * (например, в Prometheus) в порядке возрастания значений.
+     */
+    template <typename F>
+    void ForEachBucket(F &&fn) const {
+        for (size_t i = 0; i < _counts.size(); i++) {
+            if (_counts[i] > 0) {
+                fn(BucketUpperBound(i), _counts[i]);
+            }
+        }
+    }
+
+    static size_t BucketIndex(uint64_t value) { return LogLinearBucketIndex(value, kSubBucketBits); }
+    static uint64_t BucketUpperBound(size_t index) { return LogLinearBucketUpperBound(index, kSubBucketBits); }
+
+private:
+    std::vector<uint64_t> _counts;
+    uint64_t _count = 0;
+    uint64_t _min = UINT64_MAX;
+    uint64_t _max = 0;
+    long double _sum = 0;
+};
+
+#endif // LATENCY_HISTOGRAM_H
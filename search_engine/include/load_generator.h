@@ -0,0 +1,96 @@
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "latency_histogram.h"
+#include "search_server.h"
+#include "socket_utils.h"
+
+/**
+ * Режим нагрузки.
+ *  OpenLoop   - запросы отправляются по расписанию с фиксированной частотой,
+ *               независимо от ответов; задержка отсчитывается от планового
+ *               времени отправки, поэтому очередь из-за медленных ответов
+ *               попадает в замеры (нет скоординированного упущения).
+ *  ClosedLoop - фиксированное число клиентов, каждый отправляет следующий
+ *               запрос после ответа на предыдущий.
+ */
+enum class LoadMode {
+    OpenLoop,
+    ClosedLoop
+};
+
+struct LoadOptions {
+    LoadMode mode = LoadMode::ClosedLoop;
+    // Частота запросов в секунду (OpenLoop)
+    double qps = 100;
+    // Клиенты (ClosedLoop) или максимум запросов в полёте (OpenLoop)
+    size_t concurrency = 8;
+    std::chrono::milliseconds duration{10000};
+    // ClosedLoop: ожидаемый интервал между запросами одного клиента в нс;
+    // если задан, долгие ответы дополняются поправкой HdrHistogram
+    uint64_t expected_interval_ns = 0;
+};
+
+struct LoadReport {
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    double seconds = 0;
+    // Задержки в наносекундах
+    LatencyHistogram latency;
+
+    double Throughput() const { return seconds > 0 ? static_cast<double>(requests) / seconds : 0; }
+};
+
+/**
+ * Клиент нагрузки; у каждого потока свой.
+ */
+class LoadClient {
+public:
+    virtual ~LoadClient() = default;
+
+    // Выполняет запрос; false, если сервер вернул ошибку
+    virtual bool Query(const std::string &query) = 0;
+};
+
+using LoadClientFactory = std::function<std::unique_ptr<LoadClient>()>;
+
+/**
+ * Клиент, вызывающий SearchServer в том же процессе.
+ */
+class InProcessLoadClient : public LoadClient {
+public:
+    explicit InProcessLoadClient(const SearchServer &server) : _server(server) {}
+    bool Query(const std::string &query) override;
+
+private:
+    const SearchServer &_server;
+};
+
+/**
+ * Клиент построчного протокола QueryServer (search_engine --serve).
+ */
+class SocketLoadClient : public LoadClient {
+public:
+    explicit SocketLoadClient(const SocketAddress &address);
+    ~SocketLoadClient() override;
+    bool Query(const std::string &query) override;
+
+private:
+    int _fd;
+    std::string _buffer;
+};
+
+/**
+ * Подаёт нагрузку запросами из queries (по кругу) и собирает задержки.
+ */
+LoadReport RunLoad(const std::vector<std::string> &queries, const LoadClientFactory &factory,
+                   const LoadOptions &options);
+
+#endif // LOAD_GENERATOR_H
@@ -0,0 +1,34 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+/**
+ * Файл только для чтения, отображённый в память (mmap; на платформах
+ * без mmap читается целиком). Отображение остаётся валидным, даже если
+ * файл удалён после открытия.
+ */
+class MappedFile {
+public:
+    /**
+     * Открывает и отображает файл; при ошибке бросает std::runtime_error.
+     */
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Содержимое файла (nullptr для пустого файла)
+    const char *Data() const { return _data; }
+    size_t Size() const { return _size; }
+
+private:
+    const char *_data = nullptr;
+    size_t _size = 0;
+    void *_mapping = nullptr;
+    std::string _buffer; // содержимое файла, если mmap недоступен
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,139 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Метрики: счётчики, показатели и гистограммы. Запись не берёт блокировок:
+ * каждый поток пишет в свою ячейку (шард), значения суммируются только
+ * при выгрузке. Поэтому метрики можно не отключать в рабочем режиме.
+ */
+
+namespace metrics_detail {
+
+constexpr size_t kCounterShards = 16;
+constexpr size_t kHistogramShards = 4;
+
+// Номер шарда потока: назначается по кругу при первом обращении
+size_t ThreadShard();
+
+struct alignas(64) PaddedCounter {
+    std::atomic<uint64_t> value{0};
+};
+
+} // namespace metrics_detail
+
+/**
+ * Монотонный счётчик.
+ */
+class Counter {
+public:
+    void Add(uint64_t delta = 1) {
+        _shards[metrics_detail::ThreadShard() % metrics_detail::kCounterShards]
+            .value.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    uint64_t Value() const;
+
+private:
+    metrics_detail::PaddedCounter _shards[metrics_detail::kCounterShards];
+};
+
+/**
+ * Текущее значение (размер индекса, скорость последней индексации и т.п.).
+ */
+class Gauge {
+public:
+    void Set(double value) { _value.store(value, std::memory_order_relaxed); }
+    double Value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> _value{0};
+};
+
+/**
+ * Гистограмма с лог-линейными корзинами (погрешность до 1/16).
+ * Значения целые; scale задаёт единицу при выгрузке (например, 1e9 для нс -> с).
+ */
+class Histogram {
+public:
+    static constexpr int kSubBucketBits = 5;
+
+    explicit Histogram(double scale = 1.0);
+
+    void Record(uint64_t value);
+
+    /**
+     * Согласованный (насколько позволяют relaxed-чтения) снимок всех шардов.
+     */
+    struct Snapshot {
+        std::unique_ptr<uint64_t[]> counts;
+        size_t buckets = 0;
+        uint64_t count = 0;
+        uint64_t sum = 0;
+
+        uint64_t ValueAtPercentile(double percentile) const;
+    };
+    Snapshot Collect() const;
+
+    double Scale() const { return _scale; }
+
+private:
+    struct alignas(64) Shard {
+        std::unique_ptr<std::atomic<uint64_t>[]> counts;
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+    };
+
+    double _scale;
+    size_t _buckets;
+    Shard _shards[metrics_detail::kHistogramShards];
+};
+
+/**
+ * Реестр метрик. Регистрация (первое обращение по имени) берёт мьютекс,
+ * дальше вызывающий держит ссылку и пишет без блокировок.
+ * Ссылки действительны до конца жизни реестра.
+ */
+class MetricsRegistry {
+public:
+    Counter &GetCounter(const std::string &name, const std::string &help);
+    Gauge &GetGauge(const std::string &name, const std::string &help);
+    Histogram &GetHistogram(const std::string &name, const std::string &help, double scale = 1.0);
+
+    // Текстовый формат Prometheus (exposition format 0.0.4)
+    std::string DumpPrometheus() const;
+
+    // JSON: {"name": value, ...}; для гистограмм - count, sum, p50, p99, p999
+    std::string DumpJson() const;
+
+private:
+    enum class Kind { Counter, Gauge, Histogram };
+
+    struct Entry {
+        std::string name;
+        std::string help;
+        Kind kind;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    Entry &Find(const std::string &name, const std::string &help, Kind kind, double scale);
+
+    mutable std::mutex _mtx;
+    std::deque<Entry> _entries;
+};
+
+/**
+ * Общий реестр процесса, в который пишут индекс, поиск и серверы.
+ */
+MetricsRegistry &Metrics();
+
+#endif // METRICS_H
@@ -0,0 +1,77 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <cstddef>
+
+/**
+ * Возвращает число потоков: requested или число ядер, если requested == 0,
+ * но не больше количества задач (и не меньше одного).
+ */
+inline size_t ResolveThreadCount(size_t requested, size_t tasks) {
+    size_t count = requested;
+    if (count == 0) {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return std::min(count, std::max<size_t>(tasks, 1));
+}
+
+/**
+ * Запускает fn(t) в thread_count потоках и дожидается их завершения.
+ * Исключение из любого потока пробрасывается вызывающему после join.
+ */
+template <typename F>
+void RunParallel(size_t thread_count, F &&fn) {
+    if (thread_count <= 1) {
+        fn(0);
+        return;
+    }
+    std::vector<std::exception_ptr> errors(thread_count);
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+    for (size_t t = 0; t < thread_count; t++) {
+        threads.emplace_back([&fn, &errors, t]() {
+            try {
+                fn(t);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    for (auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+/**
+ * Делит элементы на thread_count непрерывных диапазонов с примерно равным
+ * суммарным весом. Возвращает границы: диапазон t - [bounds[t], bounds[t + 1]).
+ */
+template <typename Weight>
+std::vector<size_t> SplitByWeight(size_t count, size_t thread_count, Weight &&weight) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += weight(i);
+    }
+    std::vector<size_t> bounds(thread_count + 1, count);
+    bounds[0] = 0;
+    size_t sum = 0;
+    size_t part = 1;
+    for (size_t i = 0; i < count && part < thread_count; i++) {
+        sum += weight(i);
+        if (sum * thread_count >= total * part) {
+            bounds[part++] = i + 1;
+        }
+    }
+    return bounds;
+}
+
+#endif // PARALLEL_H
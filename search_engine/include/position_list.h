@@ -0,0 +1,153 @@
+#ifndef POSITION_LIST_H
+#define POSITION_LIST_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include "varint.h"
+
+/**
+ * Кодирует позиции слова в одном документе (по возрастанию):
+ * число позиций, первая позиция и разности соседних - в varint.
+ */
+inline void AppendPositions(std::string &out, const uint32_t *positions, size_t count) {
+    AppendVarint(out, count);
+    uint32_t previous = 0;
+    for (size_t i = 0; i < count; i++) {
+        AppendVarint(out, positions[i] - previous);
+        previous = positions[i];
+    }
+}
+
+/**
+ * Возвращает конец записи позиций, начинающейся в p (не декодируя разности).
+ */
+inline const char *SkipPositions(const char *p, const char *end) {
+    uint64_t count = 0;
+    p = ReadVarint(p, end, count);
+    for (uint64_t i = 0; p && i < count; i++) {
+        while (p < end && (static_cast<unsigned char>(*p) & 0x80)) {
+            p++;
+        }
+        p = p < end ? p + 1 : nullptr;
+    }
+    if (!p) {
+        throw std::runtime_error("corrupted position list");
+    }
+    return p;
+}
+
+/**
+ * Представление позиций термина только для чтения: записи позиций по
+ * документам в порядке списка вхождений и смещение каждой kSkipInterval-й записи.
+ */
+struct PositionsView {
+    const char *data = nullptr;
+    size_t bytes = 0;
+    const uint64_t *skips = nullptr;
+    size_t postings = 0;
+
+    bool empty() const { return postings == 0; }
+};
+
+/**
+ * Позиции слова в документах одного термина - отдельный от PostingList поток,
+ * поэтому запросы без фраз его не читают. Запись i соответствует i-му
+ * вхождению списка; по таблице пропусков к ней можно перейти, не декодируя
+ * все предыдущие.
+ */
+class PositionList {
+public:
+    static constexpr size_t kSkipInterval = 64;
+
+    /**
+     * Добавляет закодированную запись позиций очередного документа.
+     */
+    void Append(std::string_view record) {
+        if (_postings % kSkipInterval == 0) {
+            _skips.push_back(_data.size());
+        }
+        _data.append(record.data(), record.size());
+        _postings++;
+    }
+
+    size_t Size() const { return _postings; }
+
+    // Байт данных и таблицы пропусков в куче (без запаса ёмкости). Короткие
+    // данные хранятся внутри объекта std::string (SSO) и входят в размер PositionList
+    size_t PayloadBytes() const {
+        return (DataOnHeap() ? _data.size() : 0) + _skips.size() * sizeof(uint64_t);
+    }
+    size_t CapacityBytes() const {
+        return (DataOnHeap() ? _data.capacity() + 1 : 0) + _skips.capacity() * sizeof(uint64_t);
+    }
+
+    PositionsView View() const {
+        return {_data.data(), _data.size(), _skips.data(), _postings};
+    }
+
+private:
+    bool DataOnHeap() const {
+        const char *object = reinterpret_cast<const char *>(&_data);
+        return _data.data() < object || _data.data() >= object + sizeof(_data);
+    }
+
+    std::string _data;
+    std::vector<uint64_t> _skips;
+    size_t _postings = 0;
+};
+
+/**
+ * Последовательное чтение позиций по возрастающим номерам вхождений.
+ */
+class PositionCursor {
+public:
+    explicit PositionCursor(const PositionsView &view)
+        : _view(view), _p(view.data)
+    {}
+
+    /**
+     * Декодирует позиции вхождения с номером index (не меньше предыдущего).
+     */
+    void Read(size_t index, std::vector<uint32_t> &out) {
+        const char *end = _view.data + _view.bytes;
+        // Дальний переход - по таблице пропусков, ближний - пропуском записей
+        if (index / PositionList::kSkipInterval > _index / PositionList::kSkipInterval || index < _index) {
+            _index = index / PositionList::kSkipInterval * PositionList::kSkipInterval;
+            _p = _view.data + _view.skips[index / PositionList::kSkipInterval];
+        }
+        const char *start = _p;
+        for (; _index < index; _index++) {
+            _p = SkipPositions(_p, end);
+        }
+        uint64_t count = 0;
+        _p = ReadVarint(_p, end, count);
+        out.clear();
+        uint32_t position = 0;
+        for (uint64_t i = 0; _p && i < count; i++) {
+            uint64_t delta = 0;
+            _p = ReadVarint(_p, end, delta);
+            position += static_cast<uint32_t>(delta);
+            out.push_back(position);
+        }
+        if (!_p) {
+            throw std::runtime_error("corrupted position list");
+        }
+        _bytes_read += static_cast<size_t>(_p - start);
+        _index++;
+    }
+
+    // Байт записей, пройденных с начала (пропущенные записи тоже декодируются)
+    size_t BytesRead() const { return _bytes_read; }
+
+private:
+    PositionsView _view;
+    const char *_p;
+    size_t _index = 0;
+    size_t _bytes_read = 0;
+};
+
+#endif // POSITION_LIST_H
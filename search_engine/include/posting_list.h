@@ -0,0 +1,133 @@
+#ifndef POSTING_LIST_H
+#define POSTING_LIST_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Разрядность счётчиков в списках вхождений.
+ * При переполнении счётчик насыщается максимальным значением.
+ */
+enum class CountWidth {
+    Bits32,
+    Bits16
+};
+
+/**
+ * Представление списка вхождений только для чтения: параллельные массивы
+ * doc_id и счётчиков. Заполнен ровно один из указателей counts16/counts32.
+ */
+struct PostingsView {
+    const uint32_t *doc_ids = nullptr;
+    const uint16_t *counts16 = nullptr;
+    const uint32_t *counts32 = nullptr;
+    size_t size = 0;
+
+    bool empty() const { return size == 0; }
+
+    uint32_t Count(size_t i) const {
+        return counts16 ? counts16[i] : counts32[i];
+    }
+
+    // Байт под doc_id и счётчики
+    size_t PayloadBytes() const {
+        return size * (sizeof(uint32_t) + (counts16 ? sizeof(uint16_t) : sizeof(uint32_t)));
+    }
+
+    /**
+     * Вызывает fn(doc_ids, counts, size), где counts - указатель на массив
+     * нужной разрядности. Позволяет писать один цикл подсчёта для обоих режимов.
+     */
+    template <typename F>
+    void VisitCounts(F &&fn) const {
+        if (counts16) {
+            fn(doc_ids, counts16, size);
+        } else {
+            fn(doc_ids, counts32, size);
+        }
+    }
+};
+
+/**
+ * Первый номер i >= from, для которого doc_ids[i] >= target (size, если такого нет).
+ * Галопирующий поиск: шаг от from удваивается, пока не перешагнёт target,
+ * затем двоичный поиск внутри последнего шага. Стоимость - O(log расстояния),
+ * поэтому обход короткого списка (m) с поиском в длинном (n) стоит O(m log(n/m)).
+ */
+inline size_t GallopLowerBound(const uint32_t *doc_ids, size_t size, size_t from, uint32_t target) {
+    if (from >= size || doc_ids[from] >= target) {
+        return from;
+    }
+    // Инвариант: doc_ids[low] < target
+    size_t low = from;
+    size_t step = 1;
+    while (step < size - low && doc_ids[low + step] < target) {
+        low += step;
+        step *= 2;
+    }
+    size_t high = std::min(size, low + step);
+    return static_cast<size_t>(std::lower_bound(doc_ids + low + 1, doc_ids + high, target) - doc_ids);
+}
+
+/**
+ * Список вхождений одного термина в формате SoA: doc_id (32 бита)
+ * и счётчики (16 или 32 бита) хранятся в отдельных массивах.
+ */
+class PostingList {
+public:
+    /**
+     * Добавляет вхождение; doc_id должны добавляться по возрастанию.
+     */
+    void Append(uint32_t doc_id, size_t count, CountWidth width) {
+        _doc_ids.push_back(doc_id);
+        if (width == CountWidth::Bits16) {
+            _counts16.push_back(static_cast<uint16_t>(count > UINT16_MAX ? UINT16_MAX : count));
+        } else {
+            _counts32.push_back(static_cast<uint32_t>(count > UINT32_MAX ? UINT32_MAX : count));
+        }
+    }
+
+    void Reserve(size_t n, CountWidth width) {
+        _doc_ids.reserve(n);
+        if (width == CountWidth::Bits16) {
+            _counts16.reserve(n);
+        } else {
+            _counts32.reserve(n);
+        }
+    }
+
+    size_t Size() const { return _doc_ids.size(); }
+
+    // Байт под doc_id и счётчики (без запаса ёмкости векторов)
+    size_t PayloadBytes() const {
+        return _doc_ids.size() * sizeof(uint32_t) + _counts16.size() * sizeof(uint16_t) +
+               _counts32.size() * sizeof(uint32_t);
+    }
+
+    // Байт, выделенных под массивы (с запасом ёмкости)
+    size_t CapacityBytes() const {
+        return _doc_ids.capacity() * sizeof(uint32_t) + _counts16.capacity() * sizeof(uint16_t) +
+               _counts32.capacity() * sizeof(uint32_t);
+    }
+
+    PostingsView View() const {
+        PostingsView view;
+        view.doc_ids = _doc_ids.data();
+        view.size = _doc_ids.size();
+        if (!_counts16.empty()) {
+            view.counts16 = _counts16.data();
+        } else {
+            view.counts32 = _counts32.data();
+        }
+        return view;
+    }
+
+private:
+    std::vector<uint32_t> _doc_ids;
+    std::vector<uint16_t> _counts16;
+    std::vector<uint32_t> _counts32;
+};
+
+#endif // POSTING_LIST_H
@@ -0,0 +1,106 @@
+#ifndef QUERY_SCHEDULER_H
+#define QUERY_SCHEDULER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstddef>
+#include "search_server.h"
+
+/**
+ * Класс запроса: интерактивные выполняются раньше пакетных.
+ */
+enum class QueryPriority {
+    Interactive,
+    Batch
+};
+
+/**
+ * Параметры планировщика запросов.
+ */
+struct SchedulerOptions {
+    // Сколько запросов выполняется одновременно (0 - по числу ядер)
+    size_t threads = 0;
+    // Сколько из них может быть пакетными (0 - половина, но не меньше одного);
+    // остальные потоки всегда свободны для интерактивных запросов
+    size_t batch_threads = 0;
+    // Ёмкость очередей каждого класса
+    size_t queue_capacity = 1024;
+    // Суммарная оценка стоимости (вхождений) запросов в очередях; 0 - без ограничения
+    size_t max_queued_cost = 0;
+};
+
+/**
+ * Счётчики планировщика.
+ */
+struct SchedulerStats {
+    size_t accepted = 0;
+    size_t rejected = 0;
+    size_t completed = 0;
+};
+
+/**
+ * Ограниченный планировщик перед SearchServer (контроль допуска).
+ * Число одновременно выполняемых запросов ограничено числом потоков,
+ * пакетные запросы не могут занять все потоки, а новый запрос сразу
+ * отклоняется, если очередь его класса заполнена или суммарная стоимость
+ * ожидающих запросов превысила бы max_queued_cost. Стоимость оценивается
+ * по длинам списков вхождений терминов запроса.
+ */
+class QueryScheduler {
+public:
+    using Callback = std::function<void(QueryResult &&)>;
+
+    explicit QueryScheduler(const SearchServer &server, const SchedulerOptions &options = {});
+    ~QueryScheduler();
+
+    QueryScheduler(const QueryScheduler &) = delete;
+    QueryScheduler &operator=(const QueryScheduler &) = delete;
+
+    /**
+     * Ставит запрос в очередь; done вызывается в потоке планировщика.
+     * Возвращает false (done не вызывается), если запрос отклонён.
+     */
+    bool Submit(std::string query, const QueryOptions &options, QueryPriority priority, Callback done);
+
+    /**
+     * Выполняет уже принятые запросы и останавливает потоки.
+     */
+    void Shutdown();
+
+    SchedulerStats Stats() const;
+
+private:
+    struct Job {
+        std::string query;
+        QueryOptions options;
+        size_t cost;
+        Callback done;
+    };
+
+    void Work();
+
+    const SearchServer &_server;
+    size_t _batch_threads;
+    size_t _queue_capacity;
+    size_t _max_queued_cost;
+
+    mutable std::mutex _mtx;
+    std::condition_variable _ready;
+    std::deque<Job> _interactive;
+    std::deque<Job> _batch;
+    size_t _queued_cost = 0;
+    size_t _batch_running = 0;
+    bool _stopping = false;
+    std::atomic<size_t> _accepted{0};
+    std::atomic<size_t> _rejected{0};
+    std::atomic<size_t> _completed{0};
+    std::vector<std::thread> _threads;
+};
+
+#endif // QUERY_SCHEDULER_H
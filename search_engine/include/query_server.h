@@ -0,0 +1,100 @@
+#ifndef QUERY_SERVER_H
+#define QUERY_SERVER_H
+
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "search_server.h"
+#include "socket_utils.h"
+#include "query_scheduler.h"
+
+/**
+ * Параметры сервера запросов.
+ */
+struct QueryServerOptions {
+    // Максимум одновременных соединений; лишние получают ошибку и закрываются
+    size_t max_connections = 256;
+    // Длина очереди принятия соединений
+    int backlog = 128;
+    // Максимальная длина строки запроса в байтах
+    size_t max_line_length = 1 << 20;
+    // Потоки поиска, очереди и допуск запросов
+    SchedulerOptions scheduler;
+};
+
+/**
+ * Сервер запросов с постоянно загруженным индексом.
+ * Принимает соединения по Unix-сокету или TCP (localhost) и работает
+ * по построчному JSON-протоколу: на каждую строку вида
+ *   {"query": "milk water", "k": 5, "id": 1}
+ * отвечает одной строкой
+ *   {"id": 1, "result": true, "relevance": [{"docid": 0, "rank": 1.0}]}
+ * Поля "k", "id", "timeout_ms", "priority" ("interactive" или "batch"), "explain"
+ * (true - добавить в ответ трассировку запроса) и "mode" ("and" - только документы
+ * со всеми словами, "or") необязательны;
+ * при ошибке или перегрузке возвращается {"error": "..."}.
+ * "timeout_ms" может только сократить срок сервера (SearchServer::SetQueryLimits).
+ * Если поиск остановлен по сроку или бюджету, в ответе есть "partial": true.
+ */
+class QueryServer {
+public:
+    explicit QueryServer(const SearchServer &server, const QueryServerOptions &options = {});
+    ~QueryServer();
+
+    QueryServer(const QueryServer &) = delete;
+    QueryServer &operator=(const QueryServer &) = delete;
+
+    /**
+     * Открывает сокет для прослушивания. Протокол не проверяет клиентов,
+     * поэтому TCP-адрес должен быть локальным (SocketAddress::IsLoopback),
+     * иначе бросается std::runtime_error.
+     */
+    void Listen(const SocketAddress &address);
+
+    // Фактический TCP-порт (полезно при port = 0)
+    uint16_t Port() const { return _port; }
+
+    /**
+     * Принимает соединения, пока не вызван Stop(). Каждое соединение
+     * обслуживается в своём потоке.
+     */
+    void Run();
+
+    /**
+     * Останавливает приём и закрывает все соединения. Можно вызывать из другого потока.
+     */
+    void Stop();
+
+    /**
+     * Обрабатывает одну строку протокола и возвращает строку ответа (без '\n').
+     * Поиск выполняется в потоке планировщика, вызывающий ждёт результата.
+     */
+    std::string HandleLine(const std::string &line);
+
+private:
+    struct Connection {
+        int fd = -1; // закрывает сам Serve, под _mtx; после этого -1
+        std::thread thread;
+        std::atomic<bool> done{false};
+    };
+
+    void Serve(Connection &connection);
+    void ReapFinished();
+
+    const SearchServer &_server;
+    QueryServerOptions _options;
+    int _listen_fd = -1;
+    std::string _unix_path;
+    uint16_t _port = 0;
+    std::atomic<bool> _stopping{false};
+    std::mutex _mtx;
+    std::list<std::unique_ptr<Connection>> _connections;
+    QueryScheduler _scheduler;
+};
+
+#endif // QUERY_SERVER_H
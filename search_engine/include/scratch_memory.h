@@ -0,0 +1,36 @@
+#ifndef SCRATCH_MEMORY_H
+#define SCRATCH_MEMORY_H
+
+#include <memory_resource>
+#include <cstddef>
+
+/**
+ * Статистика обращений к ресурсу памяти.
+ */
+struct MemoryResourceStats {
+    size_t allocations = 0;       // количество выделений
+    size_t bytes_allocated = 0;   // всего байт выделено
+    size_t bytes_in_use = 0;      // байт занято сейчас
+    size_t peak_bytes_in_use = 0; // максимум занятых байт
+};
+
+/**
+ * Обёртка над std::pmr::memory_resource, считающая выделения.
+ * Не потокобезопасна: предназначена для ресурсов одного потока.
+ */
+class CountingMemoryResource : public std::pmr::memory_resource {
+public:
+    explicit CountingMemoryResource(std::pmr::memory_resource *upstream);
+
+    const MemoryResourceStats &Stats() const { return _stats; }
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+    std::pmr::memory_resource *_upstream;
+    MemoryResourceStats _stats;
+};
+
+#endif // SCRATCH_MEMORY_H
@@ -0,0 +1,45 @@
+#ifndef SEARCH_PIPELINE_H
+#define SEARCH_PIPELINE_H
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstddef>
+#include "search_server.h"
+
+/**
+ * Параметры конвейера обработки запросов.
+ */
+struct PipelineOptions {
+    // Количество потоков поиска (0 - по числу ядер)
+    size_t search_threads = 0;
+    // Ёмкость очередей между стадиями
+    size_t queue_capacity = 1024;
+};
+
+/**
+ * Конвейер "чтение запросов -> параллельный поиск -> запись ответов".
+ * Стадии работают одновременно и связаны ограниченными lock-free очередями,
+ * поэтому время работы определяется самой медленной стадией, а не суммой.
+ */
+class SearchPipeline {
+public:
+    // Источник запросов: вызывает переданную функцию для каждого запроса по порядку
+    using RequestSource = std::function<void(const std::function<void(std::string &&)> &)>;
+    // Получатель ответов: вызывается в порядке номеров запросов
+    using AnswerSink = std::function<void(size_t index, std::vector<RelativeIndex> &&answer)>;
+
+    explicit SearchPipeline(const SearchServer &server, const PipelineOptions &options = {});
+
+    /**
+     * Прогоняет все запросы источника через поиск и возвращает их количество.
+     * Исключение любой стадии останавливает конвейер и пробрасывается.
+     */
+    size_t Run(const RequestSource &source, const AnswerSink &sink);
+
+private:
+    const SearchServer &_server;
+    PipelineOptions _options;
+};
+
+#endif // SEARCH_PIPELINE_H
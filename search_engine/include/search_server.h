@@ -3,6 +3,9 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <chrono>
+#include <cstdint>
 #include "inverted_index.h"
 
 /**
@@ -14,22 +17,158 @@ struct RelativeIndex {
     bool operator==(const RelativeIndex &other) const;
 };
 
+/**
+ * Как сочетаются слова запроса.
+ */
+enum class QueryMode {
+    Or, // документ с любым из слов; релевантность - сумма счётчиков
+    And // только документы со всеми словами (пересечение списков)
+};
+
+/**
+ * Ограничения одного запроса.
+ */
+struct QueryOptions {
+    // Максимум результатов
+    size_t limit = 5;
+    // Крайний срок: после него подсчёт прекращается (по умолчанию без срока)
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    // Сколько вхождений можно просмотреть (0 - без ограничения)
+    size_t max_postings = 0;
+    // Собирать трассировку выполнения (QueryResult::explain)
+    bool explain = false;
+    // Режим запроса
+    QueryMode mode = QueryMode::Or;
+};
+
+/**
+ * Трассировка одного слова запроса. Блок - SearchServer::kBlockSize вхождений,
+ * между блоками проверяются срок и бюджет; пропущенные блоки - те,
+ * что остались непросмотренными после досрочной остановки.
+ * В режиме And блоками обходится только самый короткий список; в остальных
+ * вхождения ищутся галопирующим поиском, и postings_scored у них - число
+ * прочитанных счётчиков совпавших документов.
+ */
+struct TermExplain {
+    std::string term;              // нормализованное слово
+    size_t posting_length = 0;     // длина списка вхождений (0 - слова нет в индексе)
+    size_t postings_scored = 0;
+    size_t bytes_decoded = 0;      // прочитано байт doc_id и счётчиков
+    size_t position_bytes = 0;     // прочитано байт позиций (только фразы)
+    size_t blocks_scanned = 0;
+    size_t blocks_skipped = 0;
+    std::chrono::nanoseconds time{0};
+};
+
+/**
+ * Порог top-k после обработки очередного слова: абсолютная релевантность
+ * k-го лучшего документа (0, пока кандидатов меньше k). По росту порога
+ * видно, с какого слова хвосты списков перестают влиять на выдачу.
+ */
+struct ThresholdStep {
+    size_t term = 0;               // обработанное слово (номер в QueryExplain::terms)
+    size_t candidates = 0;         // документов с ненулевой релевантностью
+    uint64_t threshold = 0;
+};
+
+/**
+ * Трассировка запроса (режим explain). Слова перечислены в порядке запроса,
+ * thresholds - в порядке обработки (от коротких списков к длинным).
+ */
+struct QueryExplain {
+    std::vector<TermExplain> terms;
+    std::vector<ThresholdStep> thresholds;
+    std::chrono::nanoseconds total_time{0};
+};
+
+/**
+ * Результат запроса. partial = true, если подсчёт остановлен по сроку
+ * или бюджету вхождений: тогда items - лучшее из просмотренного.
+ */
+struct QueryResult {
+    std::vector<RelativeIndex> items;
+    bool partial = false;
+    size_t postings_scored = 0;
+    // Заполняется, только если запрошен QueryOptions::explain
+    std::shared_ptr<QueryExplain> explain;
+};
+
 /**
  * Класс для обработки поисковых запросов.
  */
 class SearchServer {
 public:
-    // Конструктор, принимающий ссылку на InvertedIndex
-    SearchServer(InvertedIndex &idx);
+    // Размер блока вхождений: между блоками проверяются срок и бюджет запроса
+    static constexpr size_t kBlockSize = 4096;
+
+    // Конструктор, принимающий ссылку на InvertedIndex и лимит ответов на запрос
+    SearchServer(InvertedIndex &idx, size_t max_responses = 5);
 
     /**
      * Выполняет поиск по списку запросов и возвращает вектор результатов:
-     * для каждого запроса - список RelativeIndex.
+     * для каждого запроса - список RelativeIndex (не более max_responses).
      */
     std::vector<std::vector<RelativeIndex>> search(const std::vector<std::string> &queries_input);
 
+    /**
+     * Выполняет поиск по одному запросу. Потокобезопасен: рабочие буферы
+     * у каждого потока свои, индекс только читается.
+     */
+    std::vector<RelativeIndex> SearchQuery(const std::string &query) const;
+
+    /**
+     * То же, но с собственным лимитом результатов вместо max_responses.
+     */
+    std::vector<RelativeIndex> SearchQuery(const std::string &query, size_t limit) const;
+
+    /**
+     * Поиск с ограничениями времени и объёма работы. Термины просматриваются
+     * от редких к частым, поэтому при досрочной остановке отбрасываются
+     * хвосты самых длинных (наименее избирательных) списков.
+     * Текст в кавычках - фраза: "a b" ищет слова подряд, "a b"~k - по порядку
+     * и не дальше k других слов друг от друга. Фраза ранжируется как одно
+     * слово с числом совпадений вместо счётчика. Позиции нужны из индекса,
+     * построенного с IndexOptions::positions; без них фраза требует лишь
+     * присутствия всех слов в документе.
+     * В режиме QueryMode::And остаются документы со всеми словами и фразами:
+     * обходится самый короткий список, а в остальных документ ищется
+     * галопирующим поиском, поэтому время запроса определяется самым редким
+     * словом, а бюджет вхождений расходуется только на его список.
+     */
+    QueryResult Search(const std::string &query, const QueryOptions &options) const;
+
+    /**
+     * Оценка стоимости запроса: суммарная длина списков вхождений его слов,
+     * в режиме And - длина самого короткого списка на число слов.
+     */
+    size_t EstimateCost(const std::string &query, QueryMode mode = QueryMode::Or) const;
+
+    /**
+     * Ограничения по умолчанию для всех запросов: тайм-аут (0 - без срока)
+     * и бюджет вхождений (0 - без ограничения).
+     */
+    void SetQueryLimits(std::chrono::milliseconds timeout, size_t max_postings);
+
+    // Режим запросов по умолчанию (DefaultOptions, SearchQuery, search)
+    void SetQueryMode(QueryMode mode) { _mode = mode; }
+
+    /**
+     * Ограничения по умолчанию с заданным лимитом результатов;
+     * срок отсчитывается от момента вызова.
+     */
+    QueryOptions DefaultOptions(size_t limit) const;
+
+    // Лимит результатов по умолчанию
+    size_t GetMaxResponses() const { return _max_responses; }
+
 private:
     InvertedIndex &_index;
+    size_t _max_responses;
+    std::chrono::milliseconds _timeout{0};
+    size_t _max_postings = 0;
+    QueryMode _mode = QueryMode::Or;
+
+    QueryResult Score(const std::string &query, const QueryOptions &options) const;
 };
 
 #endif // SEARCH_SERVER_H
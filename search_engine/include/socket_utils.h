@@ -0,0 +1,53 @@
+#ifndef SOCKET_UTILS_H
+#define SOCKET_UTILS_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+/**
+ * Тонкие обёртки над сокетами POSIX. При ошибке бросают std::runtime_error.
+ * На платформах без POSIX-сокетов (Windows) все функции бросают исключение.
+ */
+
+/**
+ * Адрес для прослушивания/подключения: "unix:/path/to.sock",
+ * "host:port" или просто "port" (тогда host = 127.0.0.1).
+ */
+struct SocketAddress {
+    std::string unix_path;
+    std::string host = "127.0.0.1";
+    uint16_t port = 0;
+
+    bool IsUnix() const { return !unix_path.empty(); }
+
+    // Unix-сокет, localhost или IPv4-адрес из 127.0.0.0/8 (имена, кроме localhost, не разрешаются)
+    bool IsLoopback() const;
+
+    static SocketAddress Parse(const std::string &text);
+};
+
+// Открывает прослушивающий сокет; backlog - длина очереди принятия.
+// Оставшийся файл unix-сокета заменяется; если по пути лежит не сокет,
+// бросает std::runtime_error
+int ListenSocket(const SocketAddress &address, int backlog);
+
+// Подключается к серверу
+int ConnectSocket(const SocketAddress &address);
+
+// Порт, к которому фактически привязан TCP-сокет (для port = 0)
+uint16_t LocalPort(int fd);
+
+// Пишет все данные; false, если соединение закрыто
+bool WriteAll(int fd, std::string_view data);
+
+// Закрывает сокет
+void CloseSocket(int fd);
+
+// Удаляет файл unix-сокета; файлы других типов не трогает
+void RemoveUnixSocket(const std::string &path);
+
+// Прерывает блокирующие операции на сокете (shutdown на чтение и запись)
+void ShutdownSocket(int fd);
+
+#endif // SOCKET_UTILS_H
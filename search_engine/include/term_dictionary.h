@@ -0,0 +1,161 @@
+#ifndef TERM_DICTIONARY_H
+#define TERM_DICTIONARY_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <memory_resource>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+/**
+ * Хеш-функция для терминов (64 бита, обрабатывает по 8 байт за шаг).
+ * Вычисляется один раз на слово и затем передаётся во все таблицы.
+ */
+inline uint64_t HashTerm(std::string_view term) {
+    const uint64_t kMul = 0x9E3779B97F4A7C15ULL;
+    uint64_t h = 0x84222325CBF29CE4ULL ^ (term.size() * kMul);
+    size_t i = 0;
+    for (; i + 8 <= term.size(); i += 8) {
+        uint64_t chunk;
+        std::memcpy(&chunk, term.data() + i, 8);
+        h = (h ^ chunk) * kMul;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    for (size_t k = 0; i < term.size(); i++, k += 8) {
+        tail |= static_cast<uint64_t>(static_cast<unsigned char>(term[i])) << k;
+    }
+    h = (h ^ tail) * kMul;
+    h ^= h >> 32;
+    return h;
+}
+
+/**
+ * Арена для строк: байты терминов копируются в крупные блоки,
+ * поэтому на каждый термин не тратится отдельное выделение памяти.
+ * Возвращённые string_view остаются валидными до Clear().
+ */
+class StringArena {
+public:
+    explicit StringArena(size_t block_size = 64 * 1024);
+
+    /**
+     * Копирует строку в арену и возвращает представление копии.
+     */
+    std::string_view Store(std::string_view s);
+
+    /**
+     * Освобождает все блоки.
+     */
+    void Clear();
+
+    // Сколько байт занято строками
+    size_t BytesUsed() const { return _bytes_used; }
+
+    // Сколько байт выделено под блоки
+    size_t BytesReserved() const { return _bytes_reserved; }
+
+private:
+    size_t _block_size;
+    std::vector<std::unique_ptr<char[]>> _blocks;
+    size_t _block_pos = 0;
+    size_t _block_capacity = 0;
+    size_t _bytes_used = 0;
+    size_t _bytes_reserved = 0;
+};
+
+/**
+ * Словарь терминов: сопоставляет каждому слову плотный 32-битный идентификатор.
+ * Строки хранятся в StringArena, таблица - с открытой адресацией.
+ */
+class TermDictionary {
+public:
+    static constexpr uint32_t kNoTerm = UINT32_MAX;
+
+    TermDictionary() = default;
+    TermDictionary(const TermDictionary &) = delete;
+    TermDictionary &operator=(const TermDictionary &) = delete;
+
+    /**
+     * Возвращает идентификатор термина, добавляя его при необходимости.
+     * hash должен быть равен HashTerm(term).
+     */
+    uint32_t Intern(std::string_view term, uint64_t hash);
+    uint32_t Intern(std::string_view term) { return Intern(term, HashTerm(term)); }
+
+    /**
+     * Ищет термин; возвращает kNoTerm, если его нет.
+     */
+    uint32_t Find(std::string_view term, uint64_t hash) const;
+    uint32_t Find(std::string_view term) const { return Find(term, HashTerm(term)); }
+
+    // Строка по идентификатору
+    std::string_view Term(uint32_t id) const { return _terms[id]; }
+
+    // Количество терминов
+    size_t Size() const { return _terms.size(); }
+
+    // Байт строк терминов и байт, выделенных арене под них
+    size_t KeyBytes() const { return _arena.BytesUsed(); }
+    size_t KeyBytesReserved() const { return _arena.BytesReserved(); }
+
+    // Байт таблиц: представления терминов и хеш-таблица (с учётом ёмкости)
+    size_t TableBytes() const {
+        return _terms.capacity() * sizeof(std::string_view) + _slots.capacity() * sizeof(Slot);
+    }
+
+    void Clear();
+
+private:
+    struct Slot {
+        uint64_t hash;
+        uint32_t id;
+    };
+
+    void Grow();
+
+    StringArena _arena;
+    std::vector<std::string_view> _terms;
+    std::vector<Slot> _slots;
+};
+
+/**
+ * Счётчик слов одного документа. Ключи - string_view на текст документа
+ * (без копирования), хеш каждого слова хранится и используется повторно
+ * при добавлении в TermDictionary. Память берётся из переданного
+ * std::pmr::memory_resource (например, арены потока индексации).
+ */
+class TermCounter {
+public:
+    struct Item {
+        std::string_view term;
+        uint64_t hash;
+        uint32_t count;
+    };
+
+    explicit TermCounter(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    /**
+     * Увеличивает счётчик слова на единицу; возвращает номер слова в Items().
+     */
+    uint32_t Add(std::string_view term, uint64_t hash);
+
+    // Накопленные слова в порядке первого появления
+    const std::pmr::vector<Item> &Items() const { return _items; }
+
+    /**
+     * Очищает счётчик, сохраняя выделенную память.
+     */
+    void Clear();
+
+private:
+    void Grow();
+
+    std::pmr::vector<Item> _items;
+    std::pmr::vector<uint32_t> _slots; // индекс в _items + 1, 0 - пустая ячейка
+};
+
+#endif // TERM_DICTIONARY_H
@@ -0,0 +1,49 @@
+#ifndef TEXT_NORMALIZER_H
+#define TEXT_NORMALIZER_H
+
+#include <string>
+#include <string_view>
+#include <memory_resource>
+
+/**
+ * Приводит слово в кодировке UTF-8 к нижнему регистру.
+ * ASCII и кириллица обрабатываются табличным быстрым путём,
+ * остальные алфавиты - через декодирование кодовой точки.
+ * Некорректные последовательности байтов копируются без изменений.
+ * Пробельные символы не меняются, поэтому функцию можно применять
+ * сразу ко всему тексту документа.
+ */
+std::string NormalizeWord(std::string_view word);
+
+/**
+ * То же, что NormalizeWord, но пишет результат в переданный буфер
+ * (буфер очищается), чтобы не выделять память на каждое слово.
+ */
+void NormalizeWord(std::string_view word, std::string &out);
+void NormalizeWord(std::string_view word, std::pmr::string &out);
+
+/**
+ * Разбивает текст на слова по пробельным символам (как operator>> у потока)
+ * и вызывает fn(std::string_view) для каждого слова без копирования.
+ */
+template <typename F>
+void ForEachToken(std::string_view text, F &&fn) {
+    auto is_space = [](char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    };
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && is_space(text[i])) {
+            i++;
+        }
+        size_t start = i;
+        while (i < text.size() && !is_space(text[i])) {
+            i++;
+        }
+        if (i > start) {
+            fn(text.substr(start, i - start));
+        }
+    }
+}
+
+#endif // TEXT_NORMALIZER_H
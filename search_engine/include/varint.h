@@ -0,0 +1,36 @@
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/**
+ * Кодирование беззнаковых чисел переменной длины (LEB128):
+ * по 7 бит на байт, старший бит - признак продолжения.
+ */
+inline void AppendVarint(std::string &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+/**
+ * Читает число из буфера [p, end). Возвращает указатель на следующий байт
+ * или nullptr, если данные обрываются.
+ */
+inline const char *ReadVarint(const char *p, const char *end, uint64_t &value) {
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        auto byte = static_cast<unsigned char>(*p++);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+#endif // VARINT_H
@@ -0,0 +1,62 @@
+#include "answers_reader.h"
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+
+namespace {
+
+uint32_t LoadUint32(const unsigned char *p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+} // namespace
+
+bool AnswerRecord::operator==(const AnswerRecord &other) const {
+    return query_id == other.query_id && doc_id == other.doc_id && std::fabs(rank - other.rank) < 1e-6;
+}
+
+BinaryAnswersReader::BinaryAnswersReader(const std::string &path)
+    : _in(path, std::ios::binary)
+{
+    if (!_in) {
+        throw std::runtime_error("answers file " + path + " is missing");
+    }
+    unsigned char header[16];
+    if (!_in.read(reinterpret_cast<char *>(header), sizeof(header)) ||
+        std::memcmp(header, "SEAB", 4) != 0) {
+        throw std::runtime_error("answers file " + path + " has invalid header");
+    }
+    if (LoadUint32(header + 4) != 1 || LoadUint32(header + 8) != 12) {
+        throw std::runtime_error("answers file " + path + " has unsupported version");
+    }
+    _query_count = LoadUint32(header + 12);
+}
+
+bool BinaryAnswersReader::Next(AnswerRecord &record) {
+    unsigned char data[12];
+    if (!_in.read(reinterpret_cast<char *>(data), sizeof(data))) {
+        if (_in.gcount() != 0) {
+            throw std::runtime_error("answers file is truncated");
+        }
+        return false;
+    }
+    record.query_id = LoadUint32(data);
+    record.doc_id = LoadUint32(data + 4);
+    uint32_t rank_bits = LoadUint32(data + 8);
+    std::memcpy(&record.rank, &rank_bits, sizeof(record.rank));
+    return true;
+}
+
+std::vector<std::vector<AnswerRecord>> BinaryAnswersReader::ReadAll(const std::string &path) {
+    BinaryAnswersReader reader(path);
+    std::vector<std::vector<AnswerRecord>> result(reader.QueryCount());
+    AnswerRecord record;
+    while (reader.Next(record)) {
+        if (record.query_id >= result.size()) {
+            throw std::runtime_error("answers file has record for unknown query");
+        }
+        result[record.query_id].push_back(record);
+    }
+    return result;
+}
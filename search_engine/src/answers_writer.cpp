@@ -0,0 +1,231 @@
+#include "answers_writer.h"
+#include <stdexcept>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const size_t kBufferSize = 64 * 1024;
+
+const char kBinaryMagic[4] = {'S', 'E', 'A', 'B'};
+const uint32_t kBinaryVersion = 1;
+const uint32_t kBinaryRecordSize = 12;
+// Смещение поля "количество запросов" в заголовке
+const std::streamoff kBinaryCountOffset = 12;
+
+std::string TempPath(const std::string &path) {
+    return path + ".tmp";
+}
+
+// Готовый файл подменяет прежний только целиком
+void CommitFile(const std::string &temp_path, const std::string &path) {
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("cannot rename " + temp_path + " to " + path);
+    }
+}
+
+void AppendUint32(std::string &out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+} // namespace
+
+AnswersJsonWriter::AnswersJsonWriter(const std::string &path, bool pretty)
+    : _path(path), _temp_path(TempPath(path)), _out(_temp_path, std::ios::binary), _pretty(pretty)
+{
+    if (!_out) {
+        throw std::runtime_error("cannot open " + _temp_path + " for writing");
+    }
+    _buffer.reserve(kBufferSize * 2);
+}
+
+AnswersJsonWriter::~AnswersJsonWriter() {
+    // Без Finish ответы неполные: прежний файл остаётся нетронутым
+    if (!_finished) {
+        _out.close();
+        std::remove(_temp_path.c_str());
+    }
+}
+
+std::string AnswersJsonWriter::RequestId(size_t index) {
+    return "request" +
+        std::string((index < 9) ? "00" : (index < 99 ? "0" : "")) +
+        std::to_string(index + 1);
+}
+
+void AnswersJsonWriter::NewLine(int depth) {
+    if (_pretty) {
+        _buffer.push_back('\n');
+        _buffer.append(static_cast<size_t>(depth) * 4, ' ');
+    }
+}
+
+void AnswersJsonWriter::Write(const std::vector<std::pair<int, float>> &answer) {
+    const char *colon = _pretty ? ": " : ":";
+    if (_count == 0) {
+        _buffer += "{";
+        NewLine(1);
+        _buffer += "\"answers\"";
+        _buffer += colon;
+        _buffer += "{";
+    } else {
+        _buffer += ",";
+    }
+    NewLine(2);
+    _buffer += "\"" + RequestId(_count) + "\"";
+    _buffer += colon;
+    _buffer += "{";
+    if (!answer.empty()) {
+        NewLine(3);
+        _buffer += "\"relevance\"";
+        _buffer += colon;
+        _buffer += "[";
+        char number[64];
+        for (size_t i = 0; i < answer.size(); i++) {
+            if (i > 0) {
+                _buffer += ",";
+            }
+            NewLine(4);
+            _buffer += "{";
+            NewLine(5);
+            _buffer += "\"docid\"";
+            _buffer += colon;
+            _buffer += std::to_string(answer[i].first);
+            _buffer += ",";
+            NewLine(5);
+            _buffer += "\"rank\"";
+            _buffer += colon;
+            // Кратчайшая запись, которая читается обратно в то же число;
+            // целые дополняем ".0", как nlohmann::json
+            double rank = answer[i].second;
+            if (std::isfinite(rank)) {
+                auto result = std::to_chars(number, number + sizeof(number), rank);
+                size_t length = static_cast<size_t>(result.ptr - number);
+                _buffer.append(number, length);
+                if (!std::memchr(number, '.', length) && !std::memchr(number, 'e', length)) {
+                    _buffer += ".0";
+                }
+            } else {
+                _buffer += "null";
+            }
+            NewLine(4);
+            _buffer += "}";
+        }
+        NewLine(3);
+        _buffer += "],";
+        NewLine(3);
+        _buffer += "\"result\"";
+        _buffer += colon;
+        _buffer += "\"true\"";
+    } else {
+        NewLine(3);
+        _buffer += "\"result\"";
+        _buffer += colon;
+        _buffer += "\"false\"";
+    }
+    NewLine(2);
+    _buffer += "}";
+    _count++;
+    FlushIfFull();
+}
+
+void AnswersJsonWriter::Finish() {
+    if (_finished) {
+        return;
+    }
+    _finished = true;
+    if (_count == 0) {
+        _buffer += "{";
+        NewLine(1);
+        _buffer += _pretty ? "\"answers\": {}" : "\"answers\":{}";
+    } else {
+        NewLine(1);
+        _buffer += "}";
+    }
+    NewLine(0);
+    _buffer += "}";
+    Flush();
+    _out.close();
+    if (_out.fail()) {
+        std::remove(_temp_path.c_str());
+        throw std::runtime_error("failed to write answers");
+    }
+    CommitFile(_temp_path, _path);
+}
+
+void AnswersJsonWriter::FlushIfFull() {
+    if (_buffer.size() >= kBufferSize) {
+        Flush();
+    }
+}
+
+void AnswersJsonWriter::Flush() {
+    _out.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+    _buffer.clear();
+}
+
+AnswersBinaryWriter::AnswersBinaryWriter(const std::string &path)
+    : _path(path), _temp_path(TempPath(path)), _out(_temp_path, std::ios::binary)
+{
+    if (!_out) {
+        throw std::runtime_error("cannot open " + _temp_path + " for writing");
+    }
+    _buffer.reserve(kBufferSize * 2);
+    _buffer.append(kBinaryMagic, sizeof(kBinaryMagic));
+    AppendUint32(_buffer, kBinaryVersion);
+    AppendUint32(_buffer, kBinaryRecordSize);
+    AppendUint32(_buffer, 0); // количество запросов, заполняется в Finish
+}
+
+AnswersBinaryWriter::~AnswersBinaryWriter() {
+    // Без Finish ответы неполные: прежний файл остаётся нетронутым
+    if (!_finished) {
+        _out.close();
+        std::remove(_temp_path.c_str());
+    }
+}
+
+void AnswersBinaryWriter::Write(const std::vector<std::pair<int, float>> &answer) {
+    if (_count == UINT32_MAX) {
+        throw std::runtime_error("too many requests for binary answers");
+    }
+    for (auto &item : answer) {
+        uint32_t rank_bits;
+        std::memcpy(&rank_bits, &item.second, sizeof(rank_bits));
+        AppendUint32(_buffer, _count);
+        AppendUint32(_buffer, static_cast<uint32_t>(item.first));
+        AppendUint32(_buffer, rank_bits);
+    }
+    _count++;
+    if (_buffer.size() >= kBufferSize) {
+        Flush();
+    }
+}
+
+void AnswersBinaryWriter::Finish() {
+    if (_finished) {
+        return;
+    }
+    _finished = true;
+    Flush();
+    std::string count;
+    AppendUint32(count, _count);
+    _out.seekp(kBinaryCountOffset);
+    _out.write(count.data(), static_cast<std::streamsize>(count.size()));
+    _out.close();
+    if (_out.fail()) {
+        std::remove(_temp_path.c_str());
+        throw std::runtime_error("failed to write answers");
+    }
+    CommitFile(_temp_path, _path);
+}
+
+void AnswersBinaryWriter::Flush() {
+    _out.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+    _buffer.clear();
+}
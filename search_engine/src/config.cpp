@@ -0,0 +1,155 @@
+#include "config.h"
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <stdexcept>
+#include <cstdint>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Неотрицательное целое из необязательного поля
+size_t GetSize(const json &config, const char *key, size_t default_value) {
+    if (!config.contains(key)) {
+        return default_value;
+    }
+    const auto &value = config[key];
+    if (!value.is_number_integer() || value.get<long long>() < 0) {
+        throw std::runtime_error(std::string("config.json: ") + key + " must be a non-negative integer");
+    }
+    return value.get<size_t>();
+}
+
+// Строка из необязательного поля
+std::string GetString(const json &config, const char *key, const std::string &default_value) {
+    if (!config.contains(key)) {
+        return default_value;
+    }
+    if (!config[key].is_string()) {
+        throw std::runtime_error(std::string("config.json: ") + key + " must be a string");
+    }
+    return config[key].get<std::string>();
+}
+
+// Флаг из необязательного поля: true/false или 0/1
+bool GetBool(const json &config, const char *key, bool default_value) {
+    if (!config.contains(key)) {
+        return default_value;
+    }
+    const auto &value = config[key];
+    if (value.is_boolean()) {
+        return value.get<bool>();
+    }
+    if (value.is_number_integer() && (value.get<long long>() == 0 || value.get<long long>() == 1)) {
+        return value.get<long long>() == 1;
+    }
+    throw std::runtime_error(std::string("config.json: ") + key + " must be a boolean");
+}
+
+} // namespace
+
+Config Config::Load(const std::string &path) {
+    std::ifstream config_file(path);
+    if (!config_file) {
+        throw std::runtime_error("config file is missing");
+    }
+    json config_json;
+    try {
+        config_file >> config_json;
+    } catch (const json::exception &ex) {
+        throw std::runtime_error(std::string("config file is invalid: ") + ex.what());
+    }
+    if (config_json.empty() || !config_json.contains("config")) {
+        throw std::runtime_error("config file is empty");
+    }
+    const auto &section = config_json["config"];
+    if (!section.contains("name") || !section.contains("version") || !section.contains("max_responses")) {
+        throw std::runtime_error("config file missing required fields");
+    }
+
+    Config config;
+    try {
+        config.name = section["name"].get<std::string>();
+        config.version = section["version"].get<std::string>();
+        config.max_responses = section["max_responses"].get<int>();
+    } catch (const json::exception &ex) {
+        throw std::runtime_error(std::string("config file has invalid fields: ") + ex.what());
+    }
+    if (config.version != "0.1") {
+        throw std::runtime_error("config.json has incorrect file version");
+    }
+    if (config.max_responses < 0) {
+        throw std::runtime_error("config.json: max_responses must be non-negative");
+    }
+
+    if (!config_json.contains("files") || !config_json["files"].is_array()) {
+        throw std::runtime_error("config file missing files field");
+    }
+    for (auto &file_path : config_json["files"]) {
+        if (!file_path.is_string()) {
+            throw std::runtime_error("config.json: files must be strings");
+        }
+        config.files.push_back(file_path.get<std::string>());
+    }
+
+    config.threads = GetSize(section, "threads", config.threads);
+    config.memory_budget_mb = GetSize(section, "memory_budget_mb", config.memory_budget_mb);
+    config.queue_capacity = GetSize(section, "queue_capacity", config.queue_capacity);
+    config.query_timeout_ms = GetSize(section, "query_timeout_ms", config.query_timeout_ms);
+    config.query_max_postings = GetSize(section, "query_max_postings", config.query_max_postings);
+    config.batch_threads = GetSize(section, "batch_threads", config.batch_threads);
+    config.max_queued_postings = GetSize(section, "max_queued_postings", config.max_queued_postings);
+    config.document_block_kb = GetSize(section, "document_block_kb", config.document_block_kb);
+    config.document_cache_blocks = GetSize(section, "document_cache_blocks", config.document_cache_blocks);
+    // В main бюджет переводится в байты: произведение не должно переполниться
+    if (config.memory_budget_mb > SIZE_MAX / (1024 * 1024)) {
+        throw std::runtime_error("config.json: memory_budget_mb is too large");
+    }
+    if (config.queue_capacity == 0) {
+        throw std::runtime_error("config.json: queue_capacity must be positive");
+    }
+    if (config.document_block_kb == 0 || config.document_block_kb > 1024 * 1024) {
+        throw std::runtime_error("config.json: document_block_kb must be between 1 and 1048576");
+    }
+    config.temp_dir = GetString(section, "temp_dir", config.temp_dir);
+    config.positions = GetBool(section, "positions", config.positions);
+    if (config.positions && config.memory_budget_mb > 0) {
+        throw std::runtime_error("config.json: positions cannot be combined with memory_budget_mb");
+    }
+    config.document_store = GetString(section, "document_store", config.document_store);
+    if (section.contains("document_codec")) {
+        auto codec = section["document_codec"];
+        if (codec == "lz") {
+            config.document_codec = DocumentCodec::Lz;
+        } else if (codec == "none") {
+            config.document_codec = DocumentCodec::None;
+        } else {
+            throw std::runtime_error("config.json: document_codec must be \"lz\" or \"none\"");
+        }
+    }
+    std::string query_mode = GetString(section, "query_mode", "or");
+    if (query_mode == "and") {
+        config.query_mode = QueryMode::And;
+    } else if (query_mode != "or") {
+        throw std::runtime_error("config.json: query_mode must be \"and\" or \"or\"");
+    }
+    size_t count_bits = GetSize(section, "posting_count_bits", 32);
+    if (count_bits == 16) {
+        config.count_width = CountWidth::Bits16;
+    } else if (count_bits != 32) {
+        throw std::runtime_error("config.json: posting_count_bits must be 16 or 32");
+    }
+    if (section.contains("answers_format")) {
+        auto format = section["answers_format"];
+        if (format == "pretty") {
+            config.answers_format = AnswersFormat::JsonPretty;
+        } else if (format == "compact") {
+            config.answers_format = AnswersFormat::JsonCompact;
+        } else if (format == "binary") {
+            config.answers_format = AnswersFormat::Binary;
+        } else {
+            throw std::runtime_error("config.json: answers_format must be \"pretty\", \"compact\" or \"binary\"");
+        }
+    }
+    return config;
+}
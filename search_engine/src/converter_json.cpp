@@ -4,37 +4,26 @@
 #include <sstream>
 #include <stdexcept>
 #include <iostream>
-#include <iomanip>
 
 using json = nlohmann::json;
 
-std::vector<std::string> ConverterJSON::GetTextDocuments() {
-    std::ifstream config_file("config.json");
-    if (!config_file) {
-        throw std::runtime_error("config file is missing");
-    }
-    json config_json;
-    config_file >> config_json;
-    if (config_json.empty() || !config_json.contains("config")) {
-        throw std::runtime_error("config file is empty");
-    }
-    auto config = config_json["config"];
-    if (!config.contains("name") || !config.contains("version") || !config.contains("max_responses")) {
-        throw std::runtime_error("config file missing required fields");
-    }
-    if (config["version"].get<std::string>() != "0.1") {
-        throw std::runtime_error("config.json has incorrect file version");
-    }
-
-    std::cout << "Starting " << config["name"].get<std::string>() << std::endl;
+ConverterJSON::ConverterJSON(const Config &config)
+    : config(config)
+{}
 
-    if (!config_json.contains("files") || !config_json["files"].is_array()) {
-        throw std::runtime_error("config file missing files field");
+const Config &ConverterJSON::GetConfig() {
+    if (!config) {
+        config = Config::Load("config.json");
     }
+    return *config;
+}
+
+std::vector<std::string> ConverterJSON::GetTextDocuments() {
+    const Config &cfg = GetConfig();
+    std::cout << "Starting " << cfg.name << std::endl;
 
     std::vector<std::string> documents;
-    for (auto &file_path : config_json["files"]) {
-        std::string path = file_path.get<std::string>();
+    for (auto &path : cfg.files) {
         std::ifstream in(path);
         if (!in) {
             std::cerr << "Error: file " << path << " not found." << std::endl;
@@ -48,66 +37,141 @@ std::vector<std::string> ConverterJSON::GetTextDocuments() {
 }
 
 int ConverterJSON::GetResponsesLimit() {
-    std::ifstream config_file("config.json");
-    if (!config_file) {
-        throw std::runtime_error("config file is missing");
+    return GetConfig().max_responses;
+}
+
+namespace {
+
+/**
+ * SAX-обработчик requests.json: отдаёт строки массива "requests"
+ * по одной, остальные поля пропускает.
+ */
+class RequestsSaxHandler : public nlohmann::json_sax<json> {
+public:
+    explicit RequestsSaxHandler(const std::function<void(std::string &&)> &on_request)
+        : _on_request(on_request)
+    {}
+
+    bool null() override { return Value(); }
+    bool boolean(bool) override { return Value(); }
+    bool number_integer(number_integer_t) override { return Value(); }
+    bool number_unsigned(number_unsigned_t) override { return Value(); }
+    bool number_float(number_float_t, const string_t &) override { return Value(); }
+    bool binary(binary_t &) override { return Value(); }
+
+    bool string(string_t &val) override {
+        if (_in_requests && _depth == 2) {
+            _on_request(std::move(val));
+            return true;
+        }
+        return Value();
     }
-    json config_json;
-    config_file >> config_json;
-    if (config_json.empty() || !config_json.contains("config")) {
-        throw std::runtime_error("config file is empty");
+
+    bool start_object(std::size_t) override {
+        if (_depth == 0) {
+            _root_is_object = true;
+        } else if (_in_requests && _depth == 2) {
+            return Value();
+        }
+        return Open();
     }
-    auto config = config_json["config"];
-    if (!config.contains("max_responses")) {
-        return 5;
+
+    bool end_object() override {
+        _depth--;
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        if (_depth == 1 && _key == "requests") {
+            _in_requests = true;
+            _found = true;
+        } else if (_in_requests && _depth == 2) {
+            return Value();
+        }
+        return Open();
+    }
+
+    bool end_array() override {
+        _depth--;
+        if (_depth == 1) {
+            _in_requests = false;
+        }
+        return true;
     }
-    return config["max_responses"].get<int>();
-}
+
+    bool key(string_t &val) override {
+        if (_depth == 1) {
+            _key = val;
+        }
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &ex) override {
+        throw std::runtime_error(std::string("requests.json parse error: ") + ex.what());
+    }
+
+    bool Found() const { return _found && _root_is_object; }
+
+private:
+    bool Open() {
+        _depth++;
+        return true;
+    }
+
+    bool Value() {
+        if (_in_requests && _depth == 2) {
+            throw std::runtime_error("requests.json: every request must be a string");
+        }
+        return true;
+    }
+
+    const std::function<void(std::string &&)> &_on_request;
+    int _depth = 0;
+    std::string _key;
+    bool _in_requests = false;
+    bool _found = false;
+    bool _root_is_object = false;
+};
+
+} // namespace
 
 std::vector<std::string> ConverterJSON::GetRequests() {
+    std::vector<std::string> requests;
+    StreamRequests([&requests](std::string &&request) {
+        requests.push_back(std::move(request));
+    });
+    return requests;
+}
+
+void ConverterJSON::StreamRequests(const std::function<void(std::string &&)> &on_request) {
     std::ifstream req_file("requests.json");
     if (!req_file) {
         throw std::runtime_error("requests.json file is missing");
     }
-    json req_json;
-    req_file >> req_json;
-    if (!req_json.contains("requests") || !req_json["requests"].is_array()) {
+    StreamRequests(req_file, on_request);
+}
+
+void ConverterJSON::StreamRequests(std::istream &in, const std::function<void(std::string &&)> &on_request) {
+    RequestsSaxHandler handler(on_request);
+    json::sax_parse(in, &handler);
+    if (!handler.Found()) {
         throw std::runtime_error("requests.json is empty or missing 'requests'");
     }
-    std::vector<std::string> requests;
-    for (auto &req : req_json["requests"]) {
-        requests.push_back(req.get<std::string>());
-    }
-    return requests;
 }
 
 void ConverterJSON::putAnswers(const std::vector<std::vector<std::pair<int,float>>> &answers) {
-    json ans_json;
-    ans_json["answers"] = json::object();
-
-    for (size_t i = 0; i < answers.size(); i++) {
-        std::string request_id = "request" +
-            std::string((i < 9) ? "00" : (i < 99 ? "0" : "")) +
-            std::to_string(i + 1);
-
-        if (answers[i].empty()) {
-            ans_json["answers"][request_id] = {{"result", "false"}};
-        } else {
-            json relevance = json::array();
-            for (auto &p : answers[i]) {
-                json item;
-                item["docid"] = p.first;
-                item["rank"] = p.second;
-                relevance.push_back(item);
-            }
-            ans_json["answers"][request_id] = {
-                {"result", "true"},
-                {"relevance", relevance}
-            };
-        }
+    auto writer = MakeAnswersWriter();
+    for (auto &answer : answers) {
+        writer->Write(answer);
     }
+    writer->Finish();
+}
 
-    std::ofstream out("answers.json");
-    out << std::setw(4) << ans_json;
-    out.close();
+std::unique_ptr<AnswersWriter> ConverterJSON::MakeAnswersWriter() {
+    // Формат берём из настроек, если они уже загружены
+    AnswersFormat format = config ? config->answers_format : AnswersFormat::JsonPretty;
+    if (format == AnswersFormat::Binary) {
+        return std::make_unique<AnswersBinaryWriter>("answers.bin");
+    }
+    return std::make_unique<AnswersJsonWriter>("answers.json", format == AnswersFormat::JsonPretty);
 }
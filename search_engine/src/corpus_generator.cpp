@@ -0,0 +1,210 @@
+#include "corpus_generator.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include "parallel.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Слоги из согласной и гласной; частые слова состоят из меньшего числа слогов
+const char *const kLatinConsonants[] = {"b", "c", "d", "f", "g", "h", "k", "l", "m", "n", "p", "r", "s", "t", "v", "z"};
+const char *const kLatinUpper[] = {"B", "C", "D", "F", "G", "H", "K", "L", "M", "N", "P", "R", "S", "T", "V", "Z"};
+const char *const kLatinVowels[] = {"a", "e", "i", "o", "u"};
+const char *const kCyrillicConsonants[] = {"б", "в", "г", "д", "ж", "з", "к", "л", "м", "н", "п", "р", "с", "т", "ф", "х"};
+const char *const kCyrillicUpper[] = {"Б", "В", "Г", "Д", "Ж", "З", "К", "Л", "М", "Н", "П", "Р", "С", "Т", "Ф", "Х"};
+const char *const kCyrillicVowels[] = {"а", "е", "и", "о", "у", "ы", "я", "ю"};
+
+uint64_t Mix(uint64_t x) {
+    // splitmix64
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Равномерное число в [0, 1); распределения std:: зависят от реализации, поэтому свои
+double Uniform(std::mt19937_64 &rng) {
+    return static_cast<double>(rng() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double Normal(std::mt19937_64 &rng) {
+    double u1 = 1.0 - Uniform(rng);
+    double u2 = Uniform(rng);
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+}
+
+size_t Poisson(std::mt19937_64 &rng, double mean) {
+    double limit = std::exp(-mean);
+    double p = 1.0;
+    size_t k = 0;
+    do {
+        k++;
+        p *= Uniform(rng);
+    } while (p > limit);
+    return k - 1;
+}
+
+// Генератор, свой для каждого потока данных (документа или журнала запросов)
+std::mt19937_64 MakeRng(uint64_t seed, uint64_t stream) {
+    return std::mt19937_64(Mix(seed ^ Mix(stream)));
+}
+
+const uint64_t kQueryStream = UINT64_MAX;
+
+} // namespace
+
+CorpusGenerator::CorpusGenerator(const CorpusOptions &options)
+    : _options(options)
+{
+    if (options.vocabulary == 0) {
+        throw std::runtime_error("corpus vocabulary must not be empty");
+    }
+    _words.reserve(options.vocabulary);
+    _capitalized.reserve(options.vocabulary);
+    _cdf.reserve(options.vocabulary);
+    double total = 0;
+    for (size_t rank = 0; rank < options.vocabulary; rank++) {
+        double u = static_cast<double>(Mix(options.seed ^ (rank * 0x9E3779B97F4A7C15ULL)) >> 11) *
+                   (1.0 / 9007199254740992.0);
+        bool cyrillic = u < options.cyrillic_share;
+        const char *const *consonants = cyrillic ? kCyrillicConsonants : kLatinConsonants;
+        const char *const *upper = cyrillic ? kCyrillicUpper : kLatinUpper;
+        const char *const *vowels = cyrillic ? kCyrillicVowels : kLatinVowels;
+        size_t vowel_count = cyrillic ? 8 : 5;
+        size_t syllables = 16 * vowel_count;
+        // Ранг в системе счисления по основанию "число слогов": разные ранги - разные слова
+        std::string word;
+        std::string capitalized;
+        size_t n = rank;
+        bool first = true;
+        do {
+            size_t syllable = n % syllables;
+            word += consonants[syllable / vowel_count];
+            capitalized += first ? upper[syllable / vowel_count] : consonants[syllable / vowel_count];
+            word += vowels[syllable % vowel_count];
+            capitalized += vowels[syllable % vowel_count];
+            first = false;
+            n /= syllables;
+        } while (n > 0);
+        _words.push_back(std::move(word));
+        _capitalized.push_back(std::move(capitalized));
+        total += 1.0 / std::pow(static_cast<double>(rank + 1), options.zipf_exponent);
+        _cdf.push_back(total);
+    }
+    for (auto &value : _cdf) {
+        value /= total;
+    }
+}
+
+size_t CorpusGenerator::SampleRank(std::mt19937_64 &rng) const {
+    double u = Uniform(rng);
+    size_t rank = static_cast<size_t>(std::upper_bound(_cdf.begin(), _cdf.end(), u) - _cdf.begin());
+    return std::min(rank, _words.size() - 1);
+}
+
+void CorpusGenerator::AppendWords(std::mt19937_64 &rng, size_t count, std::string &out) const {
+    for (size_t i = 0; i < count; i++) {
+        if (!out.empty()) {
+            out.push_back(' ');
+        }
+        size_t rank = SampleRank(rng);
+        out += Uniform(rng) < _options.capitalized_share ? _capitalized[rank] : _words[rank];
+    }
+}
+
+std::string CorpusGenerator::Document(uint64_t index) const {
+    auto rng = MakeRng(_options.seed, index);
+    double sigma = _options.doc_length_sigma;
+    double mu = std::log(std::max(_options.doc_length_mean, 1.0)) - sigma * sigma / 2;
+    double length = std::round(std::exp(mu + sigma * Normal(rng)));
+    size_t words = static_cast<size_t>(std::clamp(length, 1.0, static_cast<double>(std::max<size_t>(_options.doc_length_max, 1))));
+    std::string text;
+    AppendWords(rng, words, text);
+    return text;
+}
+
+std::string CorpusGenerator::Document(uint64_t index, size_t words) const {
+    auto rng = MakeRng(_options.seed, index);
+    std::string text;
+    AppendWords(rng, words, text);
+    return text;
+}
+
+std::vector<std::string> CorpusGenerator::Queries(size_t count) const {
+    auto rng = MakeRng(_options.seed, kQueryStream);
+    std::vector<std::string> queries;
+    queries.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        if (!queries.empty() && Uniform(rng) < _options.query_repeat_rate) {
+            // Повторы смещены к ранним запросам: они становятся "популярными"
+            double u = Uniform(rng);
+            queries.push_back(queries[static_cast<size_t>(u * u * static_cast<double>(queries.size()))]);
+            continue;
+        }
+        size_t terms = 1 + Poisson(rng, std::max(_options.query_terms_mean - 1.0, 0.0));
+        terms = std::min(terms, std::max<size_t>(_options.query_terms_max, 1));
+        std::string query;
+        AppendWords(rng, terms, query);
+        queries.push_back(std::move(query));
+    }
+    return queries;
+}
+
+void WriteCorpus(const std::string &dir, const CorpusGenerator &generator,
+                 size_t documents, size_t queries, size_t threads) {
+    const size_t kFilesPerDirectory = 1000;
+    auto relative_path = [](size_t i) {
+        char name[64];
+        std::snprintf(name, sizeof(name), "resources/%05zu/%09zu.txt", i / kFilesPerDirectory, i);
+        return std::string(name);
+    };
+    fs::path root(dir);
+    fs::create_directories(root);
+
+    // Файлы документов пишутся параллельно: каждый документ не зависит от остальных
+    size_t thread_count = ResolveThreadCount(threads, documents);
+    std::vector<size_t> bounds = SplitByWeight(documents, thread_count, [](size_t) { return 1; });
+    RunParallel(thread_count, [&](size_t t) {
+        for (size_t i = bounds[t]; i < bounds[t + 1]; i++) {
+            fs::path path = root / relative_path(i);
+            if (i == bounds[t] || i % kFilesPerDirectory == 0) {
+                fs::create_directories(path.parent_path());
+            }
+            std::ofstream out(path, std::ios::binary);
+            out << generator.Document(i);
+            if (!out) {
+                throw std::runtime_error("cannot write " + path.string());
+            }
+        }
+    });
+
+    // config.json и requests.json пишутся потоково: при 10^8 документов
+    // список файлов не помещается в DOM
+    std::ofstream config(root / "config.json", std::ios::binary);
+    config << "{\n  \"config\": {\n    \"name\": \"SyntheticCorpus\",\n    \"version\": \"0.1\",\n"
+           << "    \"max_responses\": 5\n  },\n  \"files\": [";
+    for (size_t i = 0; i < documents; i++) {
+        config << (i == 0 ? "\n    \"" : ",\n    \"") << relative_path(i) << '"';
+    }
+    config << (documents == 0 ? "]\n}\n" : "\n  ]\n}\n");
+    if (!config) {
+        throw std::runtime_error("cannot write config.json in " + dir);
+    }
+
+    std::ofstream requests(root / "requests.json", std::ios::binary);
+    requests << "{\n  \"requests\": [";
+    auto log = generator.Queries(queries);
+    for (size_t i = 0; i < log.size(); i++) {
+        requests << (i == 0 ? "\n    " : ",\n    ") << nlohmann::json(log[i]).dump();
+    }
+    requests << (log.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    if (!requests) {
+        throw std::runtime_error("cannot write requests.json in " + dir);
+    }
+}
@@ -0,0 +1,380 @@
+#include "document_store.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace {
+
+const char kStoreMagic[4] = {'S', 'E', 'D', 'S'};
+const uint32_t kStoreVersion = 1;
+const size_t kHeaderSize = 16;
+const size_t kTrailerSize = 28;
+
+// Метод сжатия отдельного блока
+const char kBlockStored = 0;
+const char kBlockLz = 1;
+
+// Параметры кодека: хеш-таблица по 4 байтам, окно 64 КБ
+const size_t kMinMatch = 4;
+const int kHashBits = 14;
+const size_t kMaxOffset = 65535;
+
+void AppendUint32(std::string &out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void AppendUint64(std::string &out, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+uint32_t LoadUint32(const char *p) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    }
+    return value;
+}
+
+uint64_t LoadUint64(const char *p) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    }
+    return value;
+}
+
+// Длина сверх 15 кодируется байтами 255 и остатком
+void AppendLength(std::string &out, size_t length) {
+    while (length >= 255) {
+        out.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+void AppendSequence(std::string &out, std::string_view literals, size_t offset, size_t match) {
+    size_t literal_code = std::min<size_t>(literals.size(), 15);
+    size_t match_code = match == 0 ? 0 : std::min<size_t>(match - kMinMatch, 15);
+    out.push_back(static_cast<char>((literal_code << 4) | match_code));
+    if (literals.size() >= 15) {
+        AppendLength(out, literals.size() - 15);
+    }
+    out.append(literals.data(), literals.size());
+    if (match == 0) {
+        return; // последняя последовательность - только литералы
+    }
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (match - kMinMatch >= 15) {
+        AppendLength(out, match - kMinMatch - 15);
+    }
+}
+
+const char *ReadLength(const char *p, const char *end, size_t &length) {
+    unsigned char byte;
+    do {
+        if (p >= end) {
+            throw std::runtime_error("document store: truncated compressed block");
+        }
+        byte = static_cast<unsigned char>(*p++);
+        length += byte;
+    } while (byte == 255);
+    return p;
+}
+
+} // namespace
+
+std::string LzCompress(std::string_view input) {
+    std::string out;
+    out.reserve(input.size() / 2 + 16);
+    std::vector<uint32_t> table(size_t(1) << kHashBits, 0); // позиция + 1, 0 - пусто
+    const char *data = input.data();
+    size_t n = input.size();
+    size_t anchor = 0;
+    size_t i = 0;
+    while (i + kMinMatch <= n) {
+        uint32_t sequence = LoadUint32(data + i);
+        size_t hash = (sequence * 2654435761u) >> (32 - kHashBits);
+        size_t candidate = table[hash];
+        table[hash] = static_cast<uint32_t>(i + 1);
+        if (candidate == 0 || i - (candidate - 1) > kMaxOffset || LoadUint32(data + candidate - 1) != sequence) {
+            i++;
+            continue;
+        }
+        size_t match_pos = candidate - 1;
+        size_t length = kMinMatch;
+        while (i + length < n && data[match_pos + length] == data[i + length]) {
+            length++;
+        }
+        AppendSequence(out, input.substr(anchor, i - anchor), i - match_pos, length);
+        i += length;
+        anchor = i;
+    }
+    AppendSequence(out, input.substr(anchor), 0, 0);
+    return out;
+}
+
+std::string LzDecompress(std::string_view input, size_t raw_size) {
+    std::string out;
+    out.reserve(raw_size);
+    const char *p = input.data();
+    const char *end = p + input.size();
+    while (p < end) {
+        auto token = static_cast<unsigned char>(*p++);
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            p = ReadLength(p, end, literals);
+        }
+        if (static_cast<size_t>(end - p) < literals || out.size() + literals > raw_size) {
+            throw std::runtime_error("document store: corrupted compressed block");
+        }
+        out.append(p, literals);
+        p += literals;
+        if (p == end) {
+            break;
+        }
+        if (end - p < 2) {
+            throw std::runtime_error("document store: truncated compressed block");
+        }
+        size_t offset = static_cast<unsigned char>(p[0]) | (static_cast<size_t>(static_cast<unsigned char>(p[1])) << 8);
+        p += 2;
+        size_t match = token & 0x0F;
+        if (match == 15) {
+            p = ReadLength(p, end, match);
+        }
+        match += kMinMatch;
+        if (offset == 0 || offset > out.size() || out.size() + match > raw_size) {
+            throw std::runtime_error("document store: corrupted compressed block");
+        }
+        // Совпадение может перекрываться с копируемым участком: по байту
+        size_t from = out.size() - offset;
+        for (size_t k = 0; k < match; k++) {
+            out.push_back(out[from + k]);
+        }
+    }
+    if (out.size() != raw_size) {
+        throw std::runtime_error("document store: corrupted compressed block");
+    }
+    return out;
+}
+
+DocumentStoreWriter::DocumentStoreWriter(const std::string &path, const DocumentStoreOptions &options)
+    : _path(path), _temp_path(path + ".tmp"), _out(_temp_path, std::ios::binary), _options(options)
+{
+    if (!_out) {
+        throw std::runtime_error("cannot open " + _temp_path + " for writing");
+    }
+    if (_options.block_size == 0 || _options.block_size > UINT32_MAX) {
+        throw std::runtime_error("document store block size must be between 1 and 2^32 - 1");
+    }
+    std::string header(kStoreMagic, sizeof(kStoreMagic));
+    AppendUint32(header, kStoreVersion);
+    AppendUint32(header, static_cast<uint32_t>(_options.codec));
+    AppendUint32(header, static_cast<uint32_t>(_options.block_size));
+    _out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    _file_offset = header.size();
+    _block.reserve(_options.block_size * 2);
+}
+
+DocumentStoreWriter::~DocumentStoreWriter() {
+    // Без Finish хранилище неполное: временный файл удаляется, прежний остаётся
+    if (!_finished) {
+        _out.close();
+        std::remove(_temp_path.c_str());
+    }
+}
+
+void DocumentStoreWriter::Add(std::string_view text) {
+    _block.append(text.data(), text.size());
+    _doc_offsets.push_back(_doc_offsets.back() + text.size());
+    // Поток режется на блоки ровно по block_size: блок документа - offset / block_size
+    size_t pos = 0;
+    while (_block.size() - pos >= _options.block_size) {
+        FlushBlock(std::string_view(_block).substr(pos, _options.block_size));
+        pos += _options.block_size;
+    }
+    _block.erase(0, pos);
+}
+
+void DocumentStoreWriter::FlushBlock(std::string_view raw) {
+    _block_offsets.push_back(_file_offset);
+    _compressed.clear();
+    if (_options.codec == DocumentCodec::Lz) {
+        _compressed.push_back(kBlockLz);
+        _compressed += LzCompress(raw);
+    }
+    if (_compressed.empty() || _compressed.size() >= raw.size() + 1) {
+        _compressed.assign(1, kBlockStored);
+        _compressed.append(raw.data(), raw.size());
+    }
+    _out.write(_compressed.data(), static_cast<std::streamsize>(_compressed.size()));
+    _file_offset += _compressed.size();
+}
+
+void DocumentStoreWriter::Finish() {
+    if (_finished) {
+        return;
+    }
+    _finished = true;
+    if (!_block.empty()) {
+        FlushBlock(_block);
+    }
+    _block_offsets.push_back(_file_offset);
+
+    std::string tables;
+    tables.reserve((_doc_offsets.size() + _block_offsets.size()) * 8 + kTrailerSize);
+    for (uint64_t offset : _doc_offsets) {
+        AppendUint64(tables, offset);
+    }
+    for (uint64_t offset : _block_offsets) {
+        AppendUint64(tables, offset);
+    }
+    AppendUint64(tables, _doc_offsets.size() - 1);
+    AppendUint64(tables, _block_offsets.size() - 1);
+    AppendUint64(tables, _file_offset);
+    tables.append(kStoreMagic, sizeof(kStoreMagic));
+    _out.write(tables.data(), static_cast<std::streamsize>(tables.size()));
+    _out.close();
+    if (_out.fail()) {
+        std::remove(_temp_path.c_str());
+        throw std::runtime_error("failed to write document store");
+    }
+    if (std::rename(_temp_path.c_str(), _path.c_str()) != 0) {
+        std::remove(_temp_path.c_str());
+        throw std::runtime_error("cannot rename " + _temp_path + " to " + _path);
+    }
+}
+
+DocumentStore::DocumentStore(const std::string &path, size_t cache_blocks)
+    : _file(path), _data(_file.Data()), _size(_file.Size()), _cache_capacity(cache_blocks)
+{
+    if (_size < kHeaderSize + kTrailerSize || std::memcmp(_data, kStoreMagic, sizeof(kStoreMagic)) != 0 ||
+        std::memcmp(_data + _size - sizeof(kStoreMagic), kStoreMagic, sizeof(kStoreMagic)) != 0) {
+        throw std::runtime_error("not a document store: " + path);
+    }
+    if (LoadUint32(_data + 4) != kStoreVersion) {
+        throw std::runtime_error("unsupported document store version: " + path);
+    }
+    _block_size = LoadUint32(_data + 12);
+    const char *trailer = _data + _size - kTrailerSize;
+    uint64_t doc_count = LoadUint64(trailer);
+    uint64_t block_count = LoadUint64(trailer + 8);
+    uint64_t tables = LoadUint64(trailer + 16);
+    uint64_t tables_size = _size - kTrailerSize - tables;
+    if (_block_size == 0 || tables < kHeaderSize || tables > _size - kTrailerSize ||
+        doc_count >= tables_size / 8 || block_count >= tables_size / 8 ||
+        (doc_count + 1 + block_count + 1) * 8 != tables_size) {
+        throw std::runtime_error("corrupted document store tables: " + path);
+    }
+    _doc_count = static_cast<size_t>(doc_count);
+    _block_count = static_cast<size_t>(block_count);
+    _doc_table = _data + tables;
+    _block_table = _doc_table + (_doc_count + 1) * 8;
+    uint64_t raw = DocOffset(_doc_count);
+    if ((raw + _block_size - 1) / _block_size != _block_count || BlockOffset(_block_count) != tables) {
+        throw std::runtime_error("corrupted document store tables: " + path);
+    }
+}
+
+uint64_t DocumentStore::DocOffset(size_t doc_id) const {
+    return LoadUint64(_doc_table + doc_id * 8);
+}
+
+uint64_t DocumentStore::BlockOffset(size_t block) const {
+    return LoadUint64(_block_table + block * 8);
+}
+
+std::pair<uint64_t, uint64_t> DocumentStore::DocRange(size_t doc_id) const {
+    if (doc_id >= _doc_count) {
+        throw std::out_of_range("document id is out of range");
+    }
+    // Таблица не проверяется целиком при открытии: каждая запись - при чтении
+    uint64_t begin = DocOffset(doc_id);
+    uint64_t end = DocOffset(doc_id + 1);
+    if (begin > end || end > DocOffset(_doc_count)) {
+        throw std::runtime_error("document store: corrupted document table");
+    }
+    return {begin, end};
+}
+
+std::string DocumentStore::Get(size_t doc_id) const {
+    auto range = DocRange(doc_id);
+    return Read(range.first, range.second);
+}
+
+std::string DocumentStore::Prefix(size_t doc_id, size_t max_bytes) const {
+    auto range = DocRange(doc_id);
+    return Read(range.first, std::min<uint64_t>(range.second, range.first + max_bytes));
+}
+
+std::string DocumentStore::Read(uint64_t begin, uint64_t end) const {
+    std::string text;
+    text.reserve(static_cast<size_t>(end - begin));
+    while (begin < end) {
+        size_t block = static_cast<size_t>(begin / _block_size);
+        uint64_t block_begin = static_cast<uint64_t>(block) * _block_size;
+        Block data = LoadBlock(block);
+        size_t from = static_cast<size_t>(begin - block_begin);
+        size_t count = static_cast<size_t>(std::min<uint64_t>(end - begin, data->size() - from));
+        text.append(*data, from, count);
+        begin += count;
+    }
+    return text;
+}
+
+DocumentStore::Block DocumentStore::LoadBlock(size_t block) const {
+    if (_cache_capacity == 0) {
+        _misses.fetch_add(1, std::memory_order_relaxed);
+        return DecodeBlock(block);
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        auto it = _cache.find(block);
+        if (it != _cache.end()) {
+            _lru.splice(_lru.begin(), _lru, it->second);
+            _hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second->second;
+        }
+    }
+    // Распаковка - вне блокировки; два потока могут распаковать один блок одновременно
+    _misses.fetch_add(1, std::memory_order_relaxed);
+    Block data = DecodeBlock(block);
+    std::lock_guard<std::mutex> lock(_mtx);
+    if (_cache.find(block) == _cache.end()) {
+        _lru.emplace_front(block, data);
+        _cache[block] = _lru.begin();
+        if (_cache.size() > _cache_capacity) {
+            _cache.erase(_lru.back().first);
+            _lru.pop_back();
+        }
+    }
+    return data;
+}
+
+DocumentStore::Block DocumentStore::DecodeBlock(size_t block) const {
+    uint64_t begin = BlockOffset(block);
+    uint64_t end = BlockOffset(block + 1);
+    uint64_t raw_begin = static_cast<uint64_t>(block) * _block_size;
+    size_t raw_size = static_cast<size_t>(std::min<uint64_t>(_block_size, DocOffset(_doc_count) - raw_begin));
+    // Блоки лежат между заголовком и таблицами
+    if (begin < kHeaderSize || end <= begin || end > static_cast<uint64_t>(_doc_table - _data)) {
+        throw std::runtime_error("document store: corrupted block table");
+    }
+    std::string_view payload(_data + begin + 1, static_cast<size_t>(end - begin - 1));
+    if (_data[begin] == kBlockStored) {
+        if (payload.size() != raw_size) {
+            throw std::runtime_error("document store: corrupted stored block");
+        }
+        return std::make_shared<const std::string>(payload);
+    }
+    if (_data[begin] != kBlockLz) {
+        throw std::runtime_error("document store: unknown block codec");
+    }
+    return std::make_shared<const std::string>(LzDecompress(payload, raw_size));
+}
@@ -0,0 +1,599 @@
+#include "http_server.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include "metrics.h"
+#include "explain_json.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using json = nlohmann::json;
+
+namespace {
+
+const uint64_t kListenId = 0;
+const uint64_t kWakeId = 1;
+
+const char *StatusText(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 503: return "Service Unavailable";
+        default: return "Internal Server Error";
+    }
+}
+
+std::string MakeResponse(int status, const std::string &body, bool close,
+                         const char *content_type = "application/json") {
+    std::string response = "HTTP/1.1 " + std::to_string(status) + " " + StatusText(status) + "\r\n";
+    response += std::string("Content-Type: ") + content_type + "\r\n";
+    response += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    response += close ? "Connection: close\r\n" : "Connection: keep-alive\r\n";
+    response += "\r\n";
+    response += body;
+    return response;
+}
+
+std::string ErrorResponse(int status, const std::string &message, bool close) {
+    return MakeResponse(status, json({{"error", message}}).dump(-1, ' ', false, json::error_handler_t::replace), close);
+}
+
+std::string SearchResponse(const QueryResult &query_result, bool close) {
+    const auto &results = query_result.items;
+    json body;
+    body["result"] = !results.empty();
+    if (query_result.partial) {
+        body["partial"] = true;
+    }
+    if (!results.empty()) {
+        json relevance = json::array();
+        for (auto &item : results) {
+            relevance.push_back({{"docid", item.doc_id}, {"rank", item.rank}});
+        }
+        body["relevance"] = relevance;
+    }
+    if (query_result.explain) {
+        body["explain"] = ExplainToJson(*query_result.explain);
+    }
+    // Трассировка содержит слова запроса как есть: некорректный UTF-8 заменяется
+    return MakeResponse(200, body.dump(-1, ' ', false, json::error_handler_t::replace), close);
+}
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+std::string_view Trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * Разобранный заголовок запроса.
+ */
+struct RequestHead {
+    std::string_view method;
+    std::string_view target;
+    bool keep_alive = true;
+    size_t content_length = 0;
+};
+
+/**
+ * Разбирает строку запроса и заголовки; false, если запрос некорректен.
+ */
+bool ParseHead(std::string_view head, RequestHead &request) {
+    size_t line_end = head.find("\r\n");
+    std::string_view line = head.substr(0, line_end);
+    size_t sp1 = line.find(' ');
+    size_t sp2 = line.rfind(' ');
+    if (sp1 == std::string_view::npos || sp1 == sp2) {
+        return false;
+    }
+    request.method = line.substr(0, sp1);
+    request.target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    std::string_view version = line.substr(sp2 + 1);
+    if (version == "HTTP/1.1") {
+        request.keep_alive = true;
+    } else if (version == "HTTP/1.0") {
+        request.keep_alive = false;
+    } else {
+        return false;
+    }
+    while (line_end != std::string_view::npos) {
+        size_t start = line_end + 2;
+        line_end = head.find("\r\n", start);
+        line = head.substr(start, line_end == std::string_view::npos ? std::string_view::npos : line_end - start);
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        std::string_view name = Trim(line.substr(0, colon));
+        std::string_view value = Trim(line.substr(colon + 1));
+        if (EqualsIgnoreCase(name, "Connection")) {
+            if (EqualsIgnoreCase(value, "close")) {
+                request.keep_alive = false;
+            } else if (EqualsIgnoreCase(value, "keep-alive")) {
+                request.keep_alive = true;
+            }
+        } else if (EqualsIgnoreCase(name, "Content-Length")) {
+            try {
+                request.content_length = std::stoull(std::string(value));
+            } catch (const std::logic_error &) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+std::string HttpServer::UrlDecode(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (c == '+') {
+            out.push_back(' ');
+        } else if (c == '%' && i + 2 < text.size() && HexValue(text[i + 1]) >= 0 && HexValue(text[i + 2]) >= 0) {
+            out.push_back(static_cast<char>(HexValue(text[i + 1]) * 16 + HexValue(text[i + 2])));
+            i += 2;
+        } else {
+            out.push_back(c);
+        }
+    }
+    return out;
+}
+
+HttpServer::HttpServer(const SearchServer &server, const HttpServerOptions &options)
+    : _server(server), _options(options), _next_id(kWakeId + 1),
+      _scheduler(server, options.scheduler)
+{}
+
+#ifdef __linux__
+
+HttpServer::~HttpServer() {
+    // Сначала дожидаемся задач поиска: они пишут в _wake_fd
+    _scheduler.Shutdown();
+    for (auto &item : _connections) {
+        ::close(item.second->fd);
+    }
+    for (int fd : {_listen_fd, _epoll_fd, _wake_fd}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    if (!_unix_path.empty()) {
+        RemoveUnixSocket(_unix_path);
+    }
+}
+
+void HttpServer::Listen(const SocketAddress &address) {
+    _listen_fd = ListenSocket(address, _options.backlog);
+    if (address.IsUnix()) {
+        _unix_path = address.unix_path;
+    } else {
+        _port = LocalPort(_listen_fd);
+    }
+    ::fcntl(_listen_fd, F_SETFL, ::fcntl(_listen_fd, F_GETFL) | O_NONBLOCK);
+    _epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    _wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_epoll_fd < 0 || _wake_fd < 0) {
+        throw std::runtime_error(std::string("epoll setup failed: ") + std::strerror(errno));
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = kListenId;
+    ::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _listen_fd, &event);
+    event.data.u64 = kWakeId;
+    ::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _wake_fd, &event);
+}
+
+void HttpServer::Run() {
+    if (_epoll_fd < 0) {
+        throw std::runtime_error("HttpServer::Listen must be called before Run");
+    }
+    epoll_event events[256];
+    while (!_stopping.load()) {
+        int n = ::epoll_wait(_epoll_fd, events, 256, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("epoll_wait failed: ") + std::strerror(errno));
+        }
+        for (int i = 0; i < n; i++) {
+            uint64_t id = events[i].data.u64;
+            if (id == kListenId) {
+                Accept();
+                continue;
+            }
+            if (id == kWakeId) {
+                uint64_t value;
+                while (::read(_wake_fd, &value, sizeof(value)) > 0) {
+                }
+                continue;
+            }
+            auto it = _connections.find(id);
+            if (it == _connections.end()) {
+                continue;
+            }
+            Connection &connection = *it->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                CloseConnection(id);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                Read(id, connection);
+            } else if (events[i].events & EPOLLOUT) {
+                Flush(id, connection);
+            }
+        }
+        ProcessCompletions();
+    }
+    while (!_connections.empty()) {
+        CloseConnection(_connections.begin()->first);
+    }
+}
+
+void HttpServer::Stop() {
+    _stopping.store(true);
+    Wake();
+}
+
+void HttpServer::Wake() {
+    if (_wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = ::write(_wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+void HttpServer::Accept() {
+    for (;;) {
+        int fd = ::accept4(_listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                // Например, EMFILE: оставляем соединения в очереди ядра до следующего раза
+                std::cerr << "Error: accept failed: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+        if (_connections.size() >= _options.max_connections) {
+            std::string response = ErrorResponse(503, "too many connections", true);
+            ssize_t written = ::send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+            (void)written;
+            ::close(fd);
+            continue;
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        uint64_t id = _next_id++;
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        connection->events = EPOLLIN;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = id;
+        ::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &event);
+        _connections.emplace(id, std::move(connection));
+    }
+}
+
+void HttpServer::Read(uint64_t id, Connection &connection) {
+    char chunk[16 * 1024];
+    for (;;) {
+        ssize_t n = ::recv(connection.fd, chunk, sizeof(chunk), 0);
+        if (n > 0) {
+            connection.input.append(chunk, static_cast<size_t>(n));
+            if (connection.input.size() > _options.max_request_size + sizeof(chunk)) {
+                break;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (n < 0) {
+            CloseConnection(id);
+            return;
+        }
+        // Клиент закрыл свою сторону: отвечаем на уже полученные запросы
+        connection.closing = true;
+        break;
+    }
+    ParseRequests(id, connection);
+    Flush(id, connection);
+}
+
+void HttpServer::ParseRequests(uint64_t id, Connection &connection) {
+    size_t pos = 0;
+    while (connection.pending.size() < _options.max_pipeline) {
+        size_t head_end = connection.input.find("\r\n\r\n", pos);
+        if (head_end == std::string::npos) {
+            if (connection.input.size() - pos > _options.max_request_size) {
+                Reject(connection, 431, "request is too large");
+                return;
+            }
+            break;
+        }
+        std::string_view head(connection.input.data() + pos, head_end - pos);
+        RequestHead request;
+        if (!ParseHead(head, request)) {
+            Reject(connection, 400, "malformed request");
+            return;
+        }
+        if (request.content_length > _options.max_request_size) {
+            Reject(connection, 413, "request body is too large");
+            return;
+        }
+        size_t request_end = head_end + 4 + request.content_length;
+        if (connection.input.size() < request_end) {
+            break;
+        }
+        bool close = !request.keep_alive;
+        uint64_t seq = connection.next_seq++;
+        connection.pending.emplace_back();
+
+        std::string_view target = request.target;
+        size_t question = target.find('?');
+        std::string_view path = target.substr(0, question);
+        std::string_view params = question == std::string_view::npos ? std::string_view() : target.substr(question + 1);
+        std::string query;
+        bool has_query = false;
+        // Срок запроса отсчитывается с момента разбора, включая ожидание в очереди
+        QueryOptions options = _server.DefaultOptions(_server.GetMaxResponses());
+        QueryPriority priority = QueryPriority::Interactive;
+        std::string format;
+        size_t document_id = SIZE_MAX;
+        bool valid_limit = true;
+        while (!params.empty()) {
+            size_t amp = params.find('&');
+            std::string_view param = params.substr(0, amp);
+            params = amp == std::string_view::npos ? std::string_view() : params.substr(amp + 1);
+            size_t eq = param.find('=');
+            std::string_view key = param.substr(0, eq);
+            std::string value = eq == std::string_view::npos ? std::string() : UrlDecode(param.substr(eq + 1));
+            if (key == "q") {
+                query = std::move(value);
+                has_query = true;
+            } else if (key == "format") {
+                format = std::move(value);
+            } else if (key == "explain") {
+                valid_limit = valid_limit && (value == "0" || value == "1" || value == "true" || value == "false");
+                options.explain = value == "1" || value == "true";
+            } else if (key == "mode") {
+                valid_limit = valid_limit && (value == "and" || value == "or");
+                options.mode = value == "and" ? QueryMode::And : QueryMode::Or;
+            } else if (key == "priority") {
+                valid_limit = valid_limit && (value == "interactive" || value == "batch");
+                priority = value == "batch" ? QueryPriority::Batch : QueryPriority::Interactive;
+            } else if (key == "k" || key == "timeout_ms" || key == "id") {
+                bool valid = !value.empty() && value.size() <= 9 &&
+                             std::all_of(value.begin(), value.end(), [](char c) { return c >= '0' && c <= '9'; });
+                valid_limit = valid_limit && valid;
+                if (valid && key == "k") {
+                    options.limit = std::stoul(value);
+                } else if (valid && key == "id") {
+                    document_id = std::stoul(value);
+                } else if (valid) {
+                    // Срок клиента может только сократить срок сервера (query_timeout_ms)
+                    options.deadline = std::min(options.deadline,
+                                                std::chrono::steady_clock::now() + std::chrono::milliseconds(std::stoul(value)));
+                }
+            }
+        }
+
+        if (request.method != "GET") {
+            Respond(connection, seq, ErrorResponse(405, "only GET is supported", close), close);
+        } else if (path == "/metrics") {
+            if (format == "json") {
+                Respond(connection, seq, MakeResponse(200, Metrics().DumpJson(), close), close);
+            } else {
+                Respond(connection, seq, MakeResponse(200, Metrics().DumpPrometheus(), close,
+                                                      "text/plain; version=0.0.4"), close);
+            }
+        } else if (path == "/document") {
+            // Чтение из хранилища короткое (один-два блока), выполняется в потоке цикла
+            if (!_options.documents) {
+                Respond(connection, seq, ErrorResponse(404, "document store is not configured", close), close);
+            } else if (document_id >= _options.documents->Size() || !valid_limit) {
+                Respond(connection, seq, ErrorResponse(404, "unknown document id", close), close);
+            } else {
+                json body = {{"docid", document_id}, {"text", _options.documents->Get(document_id)}};
+                Respond(connection, seq, MakeResponse(200, body.dump(-1, ' ', false, json::error_handler_t::replace), close), close);
+            }
+        } else if (path != "/search") {
+            Respond(connection, seq, ErrorResponse(404, "unknown path", close), close);
+        } else if (!has_query || !valid_limit) {
+            Respond(connection, seq, ErrorResponse(400, "expected parameter q and optional k, timeout_ms, priority, explain, mode", close), close);
+        } else {
+            bool accepted = _scheduler.Submit(std::move(query), options, priority,
+                                              [this, id, seq, close](QueryResult &&result) {
+                std::string response = SearchResponse(result, close);
+                {
+                    std::lock_guard<std::mutex> lock(_completions_mtx);
+                    _completions.push_back({id, seq, std::move(response), close});
+                }
+                Wake();
+            });
+            if (!accepted) {
+                Respond(connection, seq, ErrorResponse(503, "server is overloaded", close), close);
+            }
+        }
+        pos = request_end;
+        if (close) {
+            connection.closing = true;
+            connection.input.clear();
+            pos = 0;
+            break;
+        }
+    }
+    connection.input.erase(0, pos);
+}
+
+void HttpServer::Reject(Connection &connection, int status, const std::string &message) {
+    // После ошибки разбора границы следующих запросов неизвестны: отвечаем и закрываем
+    uint64_t seq = connection.next_seq++;
+    connection.pending.emplace_back();
+    Respond(connection, seq, ErrorResponse(status, message, true), true);
+    connection.closing = true;
+    connection.input.clear();
+}
+
+void HttpServer::Respond(Connection &connection, uint64_t seq, std::string response, bool close) {
+    Pending &slot = connection.pending[seq - connection.first_seq];
+    slot.response = std::move(response);
+    slot.ready = true;
+    slot.close = close;
+    // Ответы уходят в порядке запросов: ждём, пока готовы все предыдущие
+    while (!connection.pending.empty() && connection.pending.front().ready) {
+        Pending &front = connection.pending.front();
+        connection.output += front.response;
+        bool last = front.close;
+        connection.pending.pop_front();
+        connection.first_seq++;
+        if (last) {
+            connection.closing = true;
+            connection.pending.clear();
+            break;
+        }
+    }
+}
+
+void HttpServer::Flush(uint64_t id, Connection &connection) {
+    while (connection.output_pos < connection.output.size()) {
+        ssize_t n = ::send(connection.fd, connection.output.data() + connection.output_pos,
+                           connection.output.size() - connection.output_pos, MSG_NOSIGNAL);
+        if (n > 0) {
+            connection.output_pos += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        CloseConnection(id);
+        return;
+    }
+    if (connection.output_pos == connection.output.size()) {
+        connection.output.clear();
+        connection.output_pos = 0;
+        if (connection.closing && connection.pending.empty()) {
+            CloseConnection(id);
+            return;
+        }
+    }
+    UpdateEvents(id, connection);
+}
+
+void HttpServer::UpdateEvents(uint64_t id, Connection &connection) {
+    uint32_t events = 0;
+    // Не читаем дальше, пока конвейер соединения заполнен: это обратное давление на клиента
+    if (!connection.closing && connection.pending.size() < _options.max_pipeline &&
+        connection.input.size() <= _options.max_request_size) {
+        events |= EPOLLIN;
+    }
+    if (connection.output_pos < connection.output.size()) {
+        events |= EPOLLOUT;
+    }
+    if (events != connection.events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = id;
+        ::epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.events = events;
+    }
+}
+
+void HttpServer::CloseConnection(uint64_t id) {
+    auto it = _connections.find(id);
+    if (it == _connections.end()) {
+        return;
+    }
+    ::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, it->second->fd, nullptr);
+    ::close(it->second->fd);
+    _connections.erase(it);
+}
+
+void HttpServer::ProcessCompletions() {
+    std::vector<Completion> completions;
+    {
+        std::lock_guard<std::mutex> lock(_completions_mtx);
+        completions.swap(_completions);
+    }
+    for (auto &completion : completions) {
+        auto it = _connections.find(completion.connection_id);
+        // Соединение могло закрыться, пока шёл поиск
+        if (it == _connections.end() || completion.seq < it->second->first_seq ||
+            completion.seq - it->second->first_seq >= it->second->pending.size()) {
+            continue;
+        }
+        Connection &connection = *it->second;
+        Respond(connection, completion.seq, std::move(completion.response), completion.close);
+        // Освободились места в конвейере: разбираем накопленные запросы
+        ParseRequests(completion.connection_id, connection);
+        Flush(completion.connection_id, connection);
+    }
+}
+
+#else
+
+HttpServer::~HttpServer() {
+    _scheduler.Shutdown();
+    if (_listen_fd >= 0) {
+        CloseSocket(_listen_fd);
+    }
+}
+
+void HttpServer::Listen(const SocketAddress &address) {
+    _listen_fd = ListenSocket(address, _options.backlog);
+    _port = LocalPort(_listen_fd);
+}
+
+void HttpServer::Run() {
+    throw std::runtime_error("HTTP server requires epoll and is supported only on Linux");
+}
+
+void HttpServer::Stop() {
+    _stopping.store(true);
+}
+
+#endif
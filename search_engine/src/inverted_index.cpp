@@ -1,66 +1,309 @@
 #include "inverted_index.h"
-#include <thread>
-#include <mutex>
-#include <unordered_map>
-#include <sstream>
 #include <algorithm>
-#include <cctype>
+#include <chrono>
+#include <stdexcept>
+#include "text_normalizer.h"
+#include "parallel.h"
+#include "metrics.h"
+#include "position_list.h"
 
-static std::string to_lower(const std::string &s) {
-    std::string res = s;
-    std::transform(res.begin(), res.end(), res.begin(),
-                   [](unsigned char c){ return std::tolower(c); });
-    return res;
+namespace {
+
+// Начальный буфер арены потока: типичный документ обрабатывается без malloc
+const size_t kScratchBufferSize = 256 * 1024;
+
+void AddStats(MemoryResourceStats &total, const MemoryResourceStats &part) {
+    total.allocations += part.allocations;
+    total.bytes_allocated += part.bytes_allocated;
+    total.bytes_in_use += part.bytes_in_use;
+    total.peak_bytes_in_use += part.peak_bytes_in_use;
 }
 
+/**
+ * Результат работы одного потока индексации над непрерывным
+ * диапазоном документов: локальный словарь и списки вхождений,
+ * которые уже упорядочены по doc_id.
+ */
+struct WorkerResult {
+    TermDictionary dictionary;
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> postings;
+    // Записи позиций (AppendPositions) подряд для каждого вхождения термина
+    std::vector<std::string> positions;
+    std::vector<uint32_t> global_ids;
+    IndexingMemoryStats stats;
+};
+
+} // namespace
+
 bool Entry::operator==(const Entry &other) const {
     return doc_id == other.doc_id && count == other.count;
 }
 
+InvertedIndex::InvertedIndex(const IndexOptions &options)
+    : options(options)
+{}
+
 void InvertedIndex::UpdateDocumentBase(const std::vector<std::string> &input_docs) {
-    docs = input_docs;
-    freq_dictionary.clear();
-
-    std::vector<std::thread> threads;
-    std::mutex mtx;
-
-    for (size_t i = 0; i < docs.size(); i++) {
-        threads.emplace_back([this, i, &mtx]() {
-            std::istringstream iss(docs[i]);
-            std::string word;
-            std::unordered_map<std::string, size_t> local_count;
-            while (iss >> word) {
-                word = to_lower(word);
-                local_count[word]++;
-            }
+    if (input_docs.size() > UINT32_MAX) {
+        throw std::runtime_error("too many documents for 32-bit doc ids");
+    }
+    auto started = std::chrono::steady_clock::now();
+    // Индексация читает входной вектор; копия нужна, только если тексты сохраняются
+    docs.clear();
+    docs.shrink_to_fit();
+    document_count = input_docs.size();
+    dictionary.Clear();
+    postings.clear();
+    posting_file.reset();
+    mapped_postings.clear();
+    positions.clear();
+    memory_stats = {};
+
+    size_t thread_count = ResolveThreadCount(options.threads, input_docs.size());
+
+    // Делим документы на непрерывные диапазоны с примерно равным объёмом текста.
+    // Каждый поток обходит свой диапазон по возрастанию doc_id, поэтому
+    // после склейки диапазонов по порядку списки уже отсортированы.
+    std::vector<size_t> bounds = SplitByWeight(input_docs.size(), thread_count, [&input_docs](size_t i) {
+        return input_docs[i].size() + 1;
+    });
+
+    std::vector<WorkerResult> workers(thread_count);
+
+    const bool keep_positions = options.positions;
+    RunParallel(thread_count, [&input_docs, &bounds, &workers, keep_positions](size_t t) {
+        WorkerResult &worker = workers[t];
+        // Арена потока: монотонный буфер поверх пула, который хранит
+        // освобождённые блоки между документами и не трогает общий malloc
+        CountingMemoryResource heap(std::pmr::new_delete_resource());
+        std::pmr::unsynchronized_pool_resource pool(&heap);
+        std::vector<std::byte> initial_buffer(kScratchBufferSize);
+        std::pmr::monotonic_buffer_resource arena(initial_buffer.data(), initial_buffer.size(), &pool);
+        CountingMemoryResource scratch(&arena);
+
+        for (size_t i = bounds[t]; i < bounds[t + 1]; i++) {
             {
-                std::lock_guard<std::mutex> lock(mtx);
-                for (auto &p : local_count) {
-                    freq_dictionary[p.first].push_back({i, p.second});
+                // Нормализуем документ целиком: слова становятся string_view на этот буфер
+                std::pmr::string text(&scratch);
+                NormalizeWord(input_docs[i], text);
+                TermCounter local_count(&scratch);
+                // Номер слова в Items() для каждой позиции документа (только с позициями)
+                std::pmr::vector<uint32_t> occurrences(&scratch);
+                ForEachToken(text, [&local_count, &occurrences, keep_positions](std::string_view word) {
+                    uint32_t item = local_count.Add(word, HashTerm(word));
+                    if (keep_positions) {
+                        occurrences.push_back(item);
+                    }
+                });
+                // Раскладываем позиции по словам (сортировка подсчётом, порядок сохраняется)
+                std::pmr::vector<uint32_t> starts(&scratch);
+                std::pmr::vector<uint32_t> positions(&scratch);
+                if (keep_positions) {
+                    const auto &items = local_count.Items();
+                    starts.resize(items.size() + 1, 0);
+                    for (size_t k = 0; k < items.size(); k++) {
+                        starts[k + 1] = starts[k] + items[k].count;
+                    }
+                    positions.resize(occurrences.size());
+                    std::pmr::vector<uint32_t> fill(starts.begin(), starts.end() - 1, &scratch);
+                    for (size_t position = 0; position < occurrences.size(); position++) {
+                        positions[fill[occurrences[position]]++] = static_cast<uint32_t>(position);
+                    }
                 }
+                worker.stats.peak_document_bytes =
+                    std::max(worker.stats.peak_document_bytes, scratch.Stats().bytes_in_use);
+
+                const auto &items = local_count.Items();
+                for (size_t k = 0; k < items.size(); k++) {
+                    const auto &item = items[k];
+                    uint32_t term_id = worker.dictionary.Intern(item.term, item.hash);
+                    if (term_id == worker.postings.size()) {
+                        worker.postings.emplace_back();
+                        if (keep_positions) {
+                            worker.positions.emplace_back();
+                        }
+                    }
+                    worker.postings[term_id].push_back({static_cast<uint32_t>(i), item.count});
+                    if (keep_positions) {
+                        AppendPositions(worker.positions[term_id], positions.data() + starts[k], item.count);
+                    }
+                }
+            }
+            // Все временные данные документа уничтожены - сбрасываем арену
+            arena.release();
+            worker.stats.documents++;
+        }
+        worker.stats.scratch = scratch.Stats();
+        worker.stats.heap = heap.Stats();
+    });
+
+    // Объединяем локальные словари в общий и считаем длины итоговых списков
+    std::vector<size_t> sizes;
+    for (auto &worker : workers) {
+        worker.global_ids.resize(worker.dictionary.Size());
+        for (uint32_t local_id = 0; local_id < worker.dictionary.Size(); local_id++) {
+            uint32_t term_id = dictionary.Intern(worker.dictionary.Term(local_id));
+            if (term_id == sizes.size()) {
+                sizes.push_back(0);
             }
-        });
+            sizes[term_id] += worker.postings[local_id].size();
+            worker.global_ids[local_id] = term_id;
+        }
+        memory_stats.documents += worker.stats.documents;
+        memory_stats.peak_document_bytes = std::max(memory_stats.peak_document_bytes, worker.stats.peak_document_bytes);
+        AddStats(memory_stats.scratch, worker.stats.scratch);
+        AddStats(memory_stats.heap, worker.stats.heap);
     }
 
-    for (auto &t : threads) {
-        t.join();
+    // Склеиваем списки параллельно: каждый поток отвечает за свой диапазон
+    // идентификаторов терминов и добавляет части потоков-индексаторов по порядку
+    postings.resize(sizes.size());
+    if (keep_positions) {
+        positions.resize(sizes.size());
     }
+    size_t term_count = sizes.size();
+    RunParallel(thread_count, [this, &workers, &sizes, term_count, thread_count, keep_positions](size_t t) {
+        uint32_t lo = static_cast<uint32_t>(term_count * t / thread_count);
+        uint32_t hi = static_cast<uint32_t>(term_count * (t + 1) / thread_count);
+        for (uint32_t term_id = lo; term_id < hi; term_id++) {
+            postings[term_id].Reserve(sizes[term_id], options.count_width);
+        }
+        for (auto &worker : workers) {
+            for (size_t local_id = 0; local_id < worker.global_ids.size(); local_id++) {
+                uint32_t term_id = worker.global_ids[local_id];
+                if (term_id < lo || term_id >= hi) {
+                    continue;
+                }
+                PostingList &list = postings[term_id];
+                for (auto &e : worker.postings[local_id]) {
+                    list.Append(e.first, e.second, options.count_width);
+                }
+                if (keep_positions) {
+                    // Записи переносятся по одной: таблица пропусков строится заново
+                    const std::string &data = worker.positions[local_id];
+                    const char *p = data.data();
+                    const char *end = p + data.size();
+                    while (p < end) {
+                        const char *next = SkipPositions(p, end);
+                        positions[term_id].Append(std::string_view(p, static_cast<size_t>(next - p)));
+                        p = next;
+                    }
+                }
+            }
+        }
+    });
+    if (options.keep_documents) {
+        docs = input_docs;
+    }
+    PublishMetrics(std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+}
 
-    // Сортируем каждую группу Entry по doc_id
-    for (auto &kv : freq_dictionary) {
-        auto &entries = kv.second;
-        std::sort(entries.begin(), entries.end(),
-                  [](const Entry &a, const Entry &b){
-                      return a.doc_id < b.doc_id;
-                  });
+const std::string &InvertedIndex::GetDocument(size_t doc_id) const {
+    if (docs.size() != document_count) {
+        throw std::logic_error("document texts are not kept by this index");
     }
+    return docs.at(doc_id);
+}
+
+void InvertedIndex::PublishMetrics(double seconds) const {
+    static Counter &documents = Metrics().GetCounter(
+        "search_engine_indexed_documents_total", "Documents indexed since process start");
+    static Gauge &rate = Metrics().GetGauge(
+        "search_engine_index_documents_per_second", "Indexing throughput of the last build");
+    static Gauge &terms = Metrics().GetGauge(
+        "search_engine_index_terms", "Distinct terms in the last built index");
+    static Gauge &posting_bytes = Metrics().GetGauge(
+        "search_engine_index_posting_bytes", "Bytes of doc ids and counts in posting lists");
+    size_t bytes = 0;
+    for (uint32_t term_id = 0; term_id < dictionary.Size(); term_id++) {
+        bytes += TermPostings(term_id).PayloadBytes();
+    }
+    documents.Add(document_count);
+    rate.Set(seconds > 0 ? static_cast<double>(document_count) / seconds : 0.0);
+    terms.Set(static_cast<double>(dictionary.Size()));
+    posting_bytes.Set(static_cast<double>(bytes));
 }
 
 std::vector<Entry> InvertedIndex::GetWordCount(const std::string &word) const {
-    auto lw = to_lower(word);
-    auto it = freq_dictionary.find(lw);
-    if (it != freq_dictionary.end()) {
-        return it->second;
+    PostingsView view = GetPostings(word);
+    std::vector<Entry> result;
+    result.reserve(view.size);
+    for (size_t i = 0; i < view.size; i++) {
+        result.push_back({view.doc_ids[i], view.Count(i)});
+    }
+    return result;
+}
+
+IndexMemoryReport InvertedIndex::GetMemoryReport(size_t top_terms) const {
+    IndexMemoryReport report;
+    report.dictionary_keys = dictionary.KeyBytes();
+    report.dictionary_table = dictionary.TableBytes();
+    report.allocator_overhead += dictionary.KeyBytesReserved() - dictionary.KeyBytes();
+
+    report.posting_headers = postings.capacity() * sizeof(PostingList) +
+                             mapped_postings.size() * sizeof(PostingsView);
+    report.allocator_overhead += (mapped_postings.capacity() - mapped_postings.size()) * sizeof(PostingsView);
+    for (const auto &list : postings) {
+        report.posting_payload += list.PayloadBytes();
+        report.allocator_overhead += list.CapacityBytes() - list.PayloadBytes();
+    }
+    for (const auto &view : mapped_postings) {
+        report.posting_mapped += view.PayloadBytes();
+    }
+
+    report.position_headers = positions.capacity() * sizeof(PositionList);
+    for (const auto &list : positions) {
+        report.position_payload += list.PayloadBytes();
+        report.allocator_overhead += list.CapacityBytes() - list.PayloadBytes();
+    }
+
+    report.stored_headers = docs.capacity() * sizeof(std::string);
+    for (const auto &doc : docs) {
+        // Короткие строки хранятся внутри объекта std::string (SSO) и в куче не занимают ничего
+        const char *object = reinterpret_cast<const char *>(&doc);
+        bool inline_buffer = doc.data() >= object && doc.data() < object + sizeof(doc);
+        if (!inline_buffer) {
+            report.stored_documents += doc.size();
+            report.allocator_overhead += doc.capacity() + 1 - doc.size();
+        }
+    }
+
+    // Самые объёмные термины: частичная сортировка номеров по размеру списка
+    std::vector<uint32_t> ids(dictionary.Size());
+    for (uint32_t id = 0; id < ids.size(); id++) {
+        ids[id] = id;
+    }
+    size_t count = std::min(top_terms, ids.size());
+    std::partial_sort(ids.begin(), ids.begin() + static_cast<std::ptrdiff_t>(count), ids.end(),
+                      [this](uint32_t a, uint32_t b) {
+        size_t bytes_a = TermPostings(a).PayloadBytes();
+        size_t bytes_b = TermPostings(b).PayloadBytes();
+        return bytes_a != bytes_b ? bytes_a > bytes_b : a < b;
+    });
+    for (size_t i = 0; i < count; i++) {
+        PostingsView view = TermPostings(ids[i]);
+        report.largest_terms.push_back({std::string(dictionary.Term(ids[i])), view.size, view.PayloadBytes()});
+    }
+    return report;
+}
+
+PositionsView InvertedIndex::GetPositions(const std::string &word) const {
+    if (positions.empty()) {
+        return {};
+    }
+    uint32_t term_id = dictionary.Find(NormalizeWord(word));
+    return term_id == TermDictionary::kNoTerm ? PositionsView() : positions[term_id].View();
+}
+
+PostingsView InvertedIndex::GetPostings(const std::string &word) const {
+    auto lw = NormalizeWord(word);
+    uint32_t term_id = dictionary.Find(lw);
+    if (term_id != TermDictionary::kNoTerm) {
+        return TermPostings(term_id);
     }
     return {};
 }
+
+PostingsView InvertedIndex::TermPostings(uint32_t term_id) const {
+    return posting_file ? mapped_postings[term_id] : postings[term_id].View();
+}
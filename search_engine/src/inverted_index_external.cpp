@@ -0,0 +1,427 @@
+#include "inverted_index.h"
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <queue>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include "text_normalizer.h"
+#include "parallel.h"
+#include "varint.h"
+#include "metrics.h"
+#include "mapped_file.h"
+
+#ifndef _WIN32
+#include <cstdlib>
+#include <unistd.h>
+#else
+#include <random>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char kRunMagic[4] = {'S', 'E', 'R', 'N'};
+
+// Оценка накладных расходов на один термин в буфере: вектор вхождений,
+// string_view в словаре и две ячейки хеш-таблицы
+const size_t kTermOverhead = sizeof(std::vector<std::pair<uint32_t, uint32_t>>) +
+                             sizeof(std::string_view) + 32;
+
+using Postings = std::vector<std::pair<uint32_t, uint32_t>>;
+
+/**
+ * Буфер вхождений одного потока до сброса на диск.
+ */
+struct RunBuffer {
+    TermDictionary dictionary;
+    std::vector<Postings> postings;
+    size_t bytes = 0;
+
+    // Идентификаторы терминов в лексикографическом порядке
+    std::vector<uint32_t> SortedTerms() const {
+        std::vector<uint32_t> order(postings.size());
+        for (uint32_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            return dictionary.Term(a) < dictionary.Term(b);
+        });
+        return order;
+    }
+
+    void Clear() {
+        dictionary.Clear();
+        std::vector<Postings>().swap(postings);
+        bytes = 0;
+    }
+};
+
+/**
+ * Создаёт новый пустой временный файл и возвращает его путь. Имя выбирает
+ * mkstemp, файл создаётся с O_EXCL: чужой файл или ссылка не перезаписываются.
+ */
+std::string CreateTempFile(const std::string &temp_dir, const std::string &stem) {
+    fs::path dir = temp_dir.empty() ? fs::temp_directory_path() : fs::path(temp_dir);
+#ifndef _WIN32
+    std::string path = (dir / ("search_engine_" + stem + "_XXXXXX")).string();
+    int fd = ::mkstemp(&path[0]);
+    if (fd < 0) {
+        throw std::runtime_error("cannot create temporary file in " + dir.string());
+    }
+    ::close(fd);
+    return path;
+#else
+    std::random_device rd;
+    return (dir / ("search_engine_" + stem + "_" + std::to_string(rd()) + ".tmp")).string();
+#endif
+}
+
+/**
+ * Временный файл, удаляемый в деструкторе.
+ */
+struct TempFile {
+    std::string path;
+
+    ~TempFile() {
+        std::error_code ec;
+        fs::remove(path, ec);
+    }
+};
+
+/**
+ * Временные файлы частей индекса; удаляются в деструкторе.
+ */
+struct RunFiles {
+    std::vector<std::vector<std::string>> paths; // по потокам, в порядке записи
+
+    ~RunFiles() {
+        for (auto &worker_paths : paths) {
+            for (auto &path : worker_paths) {
+                std::error_code ec;
+                fs::remove(path, ec);
+            }
+        }
+    }
+};
+
+/**
+ * Записывает буфер в файл: термины по алфавиту, для каждого - список
+ * (doc_id, count) с дельта-кодированием doc_id.
+ */
+size_t WriteRun(const RunBuffer &buffer, const std::string &path) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("cannot create temporary file " + path);
+    }
+    out.write(kRunMagic, sizeof(kRunMagic));
+    size_t written = sizeof(kRunMagic);
+    std::string chunk;
+    for (uint32_t term_id : buffer.SortedTerms()) {
+        std::string_view term = buffer.dictionary.Term(term_id);
+        const Postings &list = buffer.postings[term_id];
+        AppendVarint(chunk, term.size());
+        chunk.append(term.data(), term.size());
+        AppendVarint(chunk, list.size());
+        uint32_t prev = 0;
+        for (auto &e : list) {
+            AppendVarint(chunk, e.first - prev);
+            AppendVarint(chunk, e.second);
+            prev = e.first;
+        }
+        if (chunk.size() >= (1 << 20)) {
+            out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            written += chunk.size();
+            chunk.clear();
+        }
+    }
+    out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    written += chunk.size();
+    if (!out) {
+        throw std::runtime_error("failed to write temporary file " + path);
+    }
+    return written;
+}
+
+/**
+ * Источник для слияния: часть индекса на диске или оставшийся
+ * в памяти последний буфер потока. Выдаёт термины по алфавиту.
+ */
+class RunSource {
+public:
+    explicit RunSource(const std::string &path)
+        : _in(path, std::ios::binary)
+    {
+        char magic[sizeof(kRunMagic)];
+        if (!_in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kRunMagic)) {
+            throw std::runtime_error("temporary index file is corrupted: " + path);
+        }
+    }
+
+    explicit RunSource(const RunBuffer *buffer)
+        : _buffer(buffer), _order(buffer->SortedTerms())
+    {}
+
+    /**
+     * Переходит к следующему термину; false, если термины закончились.
+     */
+    bool Next() {
+        if (_buffer) {
+            if (_pos >= _order.size()) {
+                return false;
+            }
+            uint32_t term_id = _order[_pos++];
+            _term = _buffer->dictionary.Term(term_id);
+            _postings = _buffer->postings[term_id];
+            return true;
+        }
+        uint64_t len;
+        if (_in.peek() == std::char_traits<char>::eof()) {
+            return false;
+        }
+        len = ReadNumber();
+        _term.resize(len);
+        if (!_in.read(&_term[0], static_cast<std::streamsize>(len))) {
+            throw std::runtime_error("temporary index file is truncated");
+        }
+        uint64_t n = ReadNumber();
+        _postings.resize(n);
+        uint64_t prev = 0;
+        for (auto &e : _postings) {
+            prev += ReadNumber();
+            e.first = static_cast<uint32_t>(prev);
+            e.second = static_cast<uint32_t>(ReadNumber());
+        }
+        return true;
+    }
+
+    const std::string &Term() const { return _term; }
+    const Postings &GetPostings() const { return _postings; }
+
+private:
+    uint64_t ReadNumber() {
+        uint64_t value = 0;
+        std::streambuf *buf = _in.rdbuf();
+        for (int shift = 0; shift < 64; shift += 7) {
+            auto c = buf->sbumpc();
+            if (c == std::char_traits<char>::eof()) {
+                break;
+            }
+            value |= static_cast<uint64_t>(c & 0x7F) << shift;
+            if ((c & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw std::runtime_error("temporary index file is truncated");
+    }
+
+    std::ifstream _in;
+    const RunBuffer *_buffer = nullptr;
+    std::vector<uint32_t> _order;
+    size_t _pos = 0;
+    std::string _term;
+    Postings _postings;
+};
+
+template <typename T>
+void AppendRaw(std::string &out, T value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+} // namespace
+
+void InvertedIndex::UpdateDocumentBaseFromFiles(const std::vector<std::string> &paths) {
+    if (options.positions) {
+        throw std::logic_error("positional index requires in-memory indexing (UpdateDocumentBase)");
+    }
+    auto started = std::chrono::steady_clock::now();
+    docs.clear();
+    docs.shrink_to_fit();
+    dictionary.Clear();
+    postings.clear();
+    posting_file.reset();
+    mapped_postings.clear();
+    positions.clear();
+    memory_stats = {};
+
+    // Отбираем существующие файлы: их порядковые номера и есть doc_id
+    std::vector<std::string> files;
+    std::vector<size_t> sizes;
+    for (auto &path : paths) {
+        std::error_code ec;
+        auto size = fs::file_size(path, ec);
+        if (ec) {
+            std::cerr << "Error: file " << path << " not found." << std::endl;
+            continue;
+        }
+        files.push_back(path);
+        sizes.push_back(static_cast<size_t>(size));
+    }
+    if (files.size() > UINT32_MAX) {
+        throw std::runtime_error("too many documents for 32-bit doc ids");
+    }
+    document_count = files.size();
+
+    size_t thread_count = ResolveThreadCount(options.threads, files.size());
+    std::vector<size_t> bounds = SplitByWeight(files.size(), thread_count, [&sizes](size_t i) {
+        return sizes[i] + 1;
+    });
+    size_t budget = std::max<size_t>(options.memory_budget / thread_count, 1);
+
+    RunFiles runs;
+    runs.paths.resize(thread_count);
+    std::vector<RunBuffer> buffers(thread_count);
+    std::vector<IndexingMemoryStats> stats(thread_count);
+
+    RunParallel(thread_count, [&](size_t t) {
+        RunBuffer &buffer = buffers[t];
+        std::string raw;
+        std::string text;
+        TermCounter local_count;
+
+        auto flush = [&]() {
+            runs.paths[t].push_back(CreateTempFile(options.temp_dir, "run"));
+            const std::string &path = runs.paths[t].back();
+            stats[t].spilled_bytes += WriteRun(buffer, path);
+            stats[t].spilled_runs++;
+            buffer.Clear();
+        };
+
+        for (size_t i = bounds[t]; i < bounds[t + 1]; i++) {
+            std::ifstream in(files[i], std::ios::binary);
+            if (!in) {
+                throw std::runtime_error("cannot read file " + files[i]);
+            }
+            raw.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            NormalizeWord(raw, text);
+            local_count.Clear();
+            ForEachToken(text, [&local_count](std::string_view word) {
+                local_count.Add(word, HashTerm(word));
+            });
+            for (auto &item : local_count.Items()) {
+                uint32_t term_id = buffer.dictionary.Intern(item.term, item.hash);
+                if (term_id == buffer.postings.size()) {
+                    buffer.postings.emplace_back();
+                    buffer.bytes += item.term.size() + kTermOverhead;
+                }
+                Postings &list = buffer.postings[term_id];
+                size_t capacity = list.capacity();
+                list.push_back({static_cast<uint32_t>(i), item.count});
+                buffer.bytes += (list.capacity() - capacity) * sizeof(list[0]);
+            }
+            stats[t].documents++;
+            stats[t].peak_document_bytes = std::max(stats[t].peak_document_bytes, raw.size() + text.size());
+            if (buffer.bytes >= budget) {
+                flush();
+            }
+        }
+    });
+
+    // Источники в порядке (поток, номер части); последний буфер потока
+    // остаётся в памяти. Такой порядок совпадает с порядком doc_id.
+    std::vector<std::unique_ptr<RunSource>> sources;
+    for (size_t t = 0; t < thread_count; t++) {
+        for (auto &path : runs.paths[t]) {
+            sources.push_back(std::make_unique<RunSource>(path));
+        }
+        if (!buffers[t].postings.empty()) {
+            sources.push_back(std::make_unique<RunSource>(&buffers[t]));
+        }
+        memory_stats.documents += stats[t].documents;
+        memory_stats.peak_document_bytes = std::max(memory_stats.peak_document_bytes, stats[t].peak_document_bytes);
+        memory_stats.spilled_runs += stats[t].spilled_runs;
+        memory_stats.spilled_bytes += stats[t].spilled_bytes;
+    }
+
+    // k-путевое слияние по термину; при равенстве терминов - по номеру источника
+    using HeapItem = std::pair<const std::string *, size_t>;
+    auto greater = [](const HeapItem &a, const HeapItem &b) {
+        int cmp = a.first->compare(*b.first);
+        return cmp != 0 ? cmp > 0 : a.second > b.second;
+    };
+    std::priority_queue<HeapItem, std::vector<HeapItem>, decltype(greater)> heap(greater);
+    for (size_t s = 0; s < sources.size(); s++) {
+        if (sources[s]->Next()) {
+            heap.push({&sources[s]->Term(), s});
+        }
+    }
+
+    // Слитые списки пишутся потоком в файл: для каждого термина массив doc_id,
+    // затем массив счётчиков, с выравниванием начала списка на 4 байта.
+    // В памяти остаются только смещения списков
+    TempFile posting_path{CreateTempFile(options.temp_dir, "postings")};
+    std::ofstream out(posting_path.path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("cannot create temporary file " + posting_path.path);
+    }
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::string chunk;
+    uint64_t written = 0;
+    std::vector<size_t> same_term;
+    while (!heap.empty()) {
+        same_term.clear();
+        std::string term = *heap.top().first;
+        while (!heap.empty() && *heap.top().first == term) {
+            same_term.push_back(heap.top().second);
+            heap.pop();
+        }
+        size_t total = 0;
+        for (size_t s : same_term) {
+            total += sources[s]->GetPostings().size();
+        }
+        dictionary.Intern(term);
+        offsets.push_back(written + chunk.size());
+        lengths.push_back(static_cast<uint32_t>(total));
+        for (size_t s : same_term) {
+            for (auto &e : sources[s]->GetPostings()) {
+                AppendRaw<uint32_t>(chunk, e.first);
+            }
+        }
+        for (size_t s : same_term) {
+            for (auto &e : sources[s]->GetPostings()) {
+                if (options.count_width == CountWidth::Bits16) {
+                    AppendRaw<uint16_t>(chunk, static_cast<uint16_t>(std::min<uint32_t>(e.second, UINT16_MAX)));
+                } else {
+                    AppendRaw<uint32_t>(chunk, e.second);
+                }
+            }
+        }
+        chunk.resize((chunk.size() + 3) & ~size_t(3), '\0');
+        if (chunk.size() >= (1 << 20)) {
+            out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            written += chunk.size();
+            chunk.clear();
+        }
+        for (size_t s : same_term) {
+            if (sources[s]->Next()) {
+                heap.push({&sources[s]->Term(), s});
+            }
+        }
+    }
+    out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    out.close();
+    if (out.fail()) {
+        throw std::runtime_error("failed to write temporary file " + posting_path.path);
+    }
+
+    // Файл удаляется при выходе (TempFile), отображение остаётся валидным
+    auto file = std::make_shared<const MappedFile>(posting_path.path);
+    mapped_postings.resize(offsets.size());
+    for (size_t i = 0; i < offsets.size(); i++) {
+        PostingsView &view = mapped_postings[i];
+        const char *list = file->Data() + offsets[i];
+        view.size = lengths[i];
+        view.doc_ids = reinterpret_cast<const uint32_t *>(list);
+        const char *counts = list + lengths[i] * sizeof(uint32_t);
+        if (options.count_width == CountWidth::Bits16) {
+            view.counts16 = reinterpret_cast<const uint16_t *>(counts);
+        } else {
+            view.counts32 = reinterpret_cast<const uint32_t *>(counts);
+        }
+    }
+    posting_file = std::move(file);
+    PublishMetrics(std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+}
@@ -0,0 +1,93 @@
+#include "latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+int HighestBit(uint64_t value) {
+    int bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+}
+
+} // namespace
+
+size_t LogLinearBucketIndex(uint64_t value, int sub_bucket_bits) {
+    // Старшие биты задают порядок, следующие sub_bucket_bits - положение внутри него
+    int msb = HighestBit(value);
+    int shift = msb >= sub_bucket_bits ? msb - sub_bucket_bits + 1 : 0;
+    return (static_cast<size_t>(shift) << sub_bucket_bits) + static_cast<size_t>(value >> shift);
+}
+
+uint64_t LogLinearBucketUpperBound(size_t index, int sub_bucket_bits) {
+    int shift = static_cast<int>(index >> sub_bucket_bits);
+    uint64_t sub = index & ((size_t(1) << sub_bucket_bits) - 1);
+    if (shift == 0) {
+        return sub;
+    }
+    return (sub << shift) + ((uint64_t(1) << shift) - 1);
+}
+
+LatencyHistogram::LatencyHistogram()
+    : _counts(LogLinearBucketCount(kSubBucketBits), 0)
+{}
+
+void LatencyHistogram::Record(uint64_t value) {
+    _counts[BucketIndex(value)]++;
+    _count++;
+    _min = std::min(_min, value);
+    _max = std::max(_max, value);
+    _sum += value;
+}
+
+void LatencyHistogram::RecordCorrected(uint64_t value, uint64_t expected_interval) {
+    Record(value);
+    if (expected_interval == 0) {
+        return;
+    }
+    for (uint64_t missing = value; missing > expected_interval;) {
+        missing -= expected_interval;
+        Record(missing);
+    }
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram &other) {
+    for (size_t i = 0; i < _counts.size(); i++) {
+        _counts[i] += other._counts[i];
+    }
+    _count += other._count;
+    _min = std::min(_min, other._min);
+    _max = std::max(_max, other._max);
+    _sum += other._sum;
+}
+
+void LatencyHistogram::Clear() {
+    std::fill(_counts.begin(), _counts.end(), 0);
+    _count = 0;
+    _min = UINT64_MAX;
+    _max = 0;
+    _sum = 0;
+}
+
+double LatencyHistogram::Mean() const {
+    return _count ? static_cast<double>(_sum / _count) : 0.0;
+}
+
+uint64_t LatencyHistogram::ValueAtPercentile(double percentile) const {
+    if (_count == 0) {
+        return 0;
+    }
+    percentile = std::clamp(percentile, 0.0, 100.0);
+    auto target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(_count)));
+    target = std::max<uint64_t>(target, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < _counts.size(); i++) {
+        seen += _counts[i];
+        if (seen >= target) {
+            return std::min(BucketUpperBound(i), _max);
+        }
+    }
+    return _max;
+}
@@ -0,0 +1,109 @@
+#include "load_generator.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include "parallel.h"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <cerrno>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+bool InProcessLoadClient::Query(const std::string &query) {
+    _server.SearchQuery(query);
+    return true;
+}
+
+SocketLoadClient::SocketLoadClient(const SocketAddress &address)
+    : _fd(ConnectSocket(address))
+{}
+
+SocketLoadClient::~SocketLoadClient() {
+    CloseSocket(_fd);
+}
+
+bool SocketLoadClient::Query(const std::string &query) {
+    if (!WriteAll(_fd, nlohmann::json({{"query", query}}).dump() + "\n")) {
+        throw std::runtime_error("connection to the server is closed");
+    }
+#ifndef _WIN32
+    size_t end;
+    while ((end = _buffer.find('\n')) == std::string::npos) {
+        char chunk[4096];
+        ssize_t n = ::recv(_fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("connection to the server is closed");
+        }
+        _buffer.append(chunk, static_cast<size_t>(n));
+    }
+    bool ok = _buffer.compare(0, 9, "{\"error\":") != 0;
+    _buffer.erase(0, end + 1);
+    return ok;
+#else
+    return false;
+#endif
+}
+
+LoadReport RunLoad(const std::vector<std::string> &queries, const LoadClientFactory &factory,
+                   const LoadOptions &options) {
+    if (queries.empty()) {
+        throw std::runtime_error("no queries for the load test");
+    }
+    size_t workers = std::max<size_t>(options.concurrency, 1);
+    std::vector<std::unique_ptr<LoadClient>> clients;
+    for (size_t w = 0; w < workers; w++) {
+        clients.push_back(factory());
+    }
+    std::vector<LoadReport> reports(workers);
+    std::atomic<uint64_t> next{0};
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point end = start + options.duration;
+    const double interval_ns = options.qps > 0 ? 1e9 / options.qps : 0;
+
+    RunParallel(workers, [&](size_t w) {
+        LoadClient &client = *clients[w];
+        LoadReport &report = reports[w];
+        for (;;) {
+            uint64_t i = next.fetch_add(1, std::memory_order_relaxed);
+            Clock::time_point intended;
+            if (options.mode == LoadMode::OpenLoop) {
+                // Плановое время i-го запроса; если все клиенты заняты, запрос
+                // уходит позже, и ожидание входит в его задержку
+                intended = start + std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(i) * interval_ns));
+                if (intended >= end) {
+                    break;
+                }
+                std::this_thread::sleep_until(intended);
+            } else {
+                intended = Clock::now();
+                if (intended >= end) {
+                    break;
+                }
+            }
+            bool ok = client.Query(queries[i % queries.size()]);
+            auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - intended).count();
+            if (options.mode == LoadMode::ClosedLoop) {
+                report.latency.RecordCorrected(static_cast<uint64_t>(latency), options.expected_interval_ns);
+            } else {
+                report.latency.Record(static_cast<uint64_t>(latency));
+            }
+            report.requests++;
+            report.errors += ok ? 0 : 1;
+        }
+    });
+
+    LoadReport total;
+    total.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (auto &report : reports) {
+        total.requests += report.requests;
+        total.errors += report.errors;
+        total.latency.Merge(report.latency);
+    }
+    return total;
+}
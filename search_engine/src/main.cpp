@@ -1,45 +1,328 @@
 #include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+#include <memory>
+#include <cstdlib>
+#include <iomanip>
+#include "config.h"
 #include "converter_json.h"
 #include "inverted_index.h"
 #include "search_server.h"
+#include "search_pipeline.h"
+#include "query_server.h"
+#include "http_server.h"
+#include "metrics.h"
+#include "explain_json.h"
+#include "document_store.h"
 
-int main() {
-    try {
-        ConverterJSON converter;
+#ifndef _WIN32
+#include <csignal>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+DocumentStoreOptions MakeStoreOptions(const Config &config) {
+    DocumentStoreOptions options;
+    options.codec = config.document_codec;
+    options.block_size = config.document_block_kb * 1024;
+    return options;
+}
+
+/**
+ * Индексирует документы из config.json с учётом настроек. Если задан
+ * document_store, тексты попутно записываются в сжатое хранилище.
+ */
+void BuildIndex(ConverterJSON &converter, const Config &config, InvertedIndex &idx) {
+    if (config.memory_budget_mb > 0) {
+        // Документы читаются из файлов по одному, части индекса выгружаются на диск
+        std::cout << "Starting " << config.name << std::endl;
+        if (!config.document_store.empty()) {
+            // Номера документов совпадают с индексом: отсутствующие файлы пропускаются
+            DocumentStoreWriter writer(config.document_store, MakeStoreOptions(config));
+            std::string text;
+            for (auto &path : config.files) {
+                // Тот же признак отсутствия файла, что и в UpdateDocumentBaseFromFiles
+                std::error_code ec;
+                static_cast<void>(std::filesystem::file_size(path, ec));
+                std::ifstream in(path, std::ios::binary);
+                if (ec || !in) {
+                    continue;
+                }
+                text.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+                writer.Add(text);
+            }
+            writer.Finish();
+        }
+        idx.UpdateDocumentBaseFromFiles(config.files);
+    } else {
         // Считываем документы из config.json
-        auto docs = converter.GetTextDocuments();
-        // Считываем лимит
-        int max_responses = converter.GetResponsesLimit();
+        std::vector<std::string> texts = converter.GetTextDocuments();
+        if (!config.document_store.empty()) {
+            DocumentStoreWriter writer(config.document_store, MakeStoreOptions(config));
+            for (auto &text : texts) {
+                writer.Add(text);
+            }
+            writer.Finish();
+        }
+        idx.UpdateDocumentBase(texts);
+    }
+}
 
-        // Индексируем документы
-        InvertedIndex idx;
-        idx.UpdateDocumentBase(docs);
-
-        // Считываем запросы
-        auto requests = converter.GetRequests();
-
-        // Поиск
-        SearchServer srv(idx);
-        auto results = srv.search(requests);
-
-        // Обрезаем до max_responses
-        std::vector<std::vector<std::pair<int, float>>> answers;
-        answers.reserve(results.size());
-        for (auto &row : results) {
-            // Оставляем только TopN
-            if ((int)row.size() > max_responses) {
-                row.resize(max_responses);
-            }
-            std::vector<std::pair<int, float>> temp;
-            temp.reserve(row.size());
+/**
+ * Печатает, сколько памяти занимает каждая структура индекса.
+ */
+void PrintMemoryReport(const InvertedIndex &idx) {
+    IndexMemoryReport report = idx.GetMemoryReport();
+    size_t total = report.Total();
+    auto line = [total](const char *name, size_t bytes) {
+        double share = total > 0 ? 100.0 * static_cast<double>(bytes) / static_cast<double>(total) : 0.0;
+        std::cout << "  " << std::left << std::setw(20) << name << std::right << std::setw(14) << bytes
+                  << "  " << std::fixed << std::setprecision(1) << std::setw(5) << share << "%\n";
+    };
+    std::cout << "Index memory, bytes:\n";
+    line("dictionary keys", report.dictionary_keys);
+    line("dictionary table", report.dictionary_table);
+    line("posting payload", report.posting_payload);
+    line("posting headers", report.posting_headers);
+    if (report.position_headers > 0) {
+        line("position payload", report.position_payload);
+        line("position headers", report.position_headers);
+    }
+    line("stored documents", report.stored_documents);
+    line("stored headers", report.stored_headers);
+    line("allocator overhead", report.allocator_overhead);
+    line("total", total);
+    if (report.posting_mapped > 0) {
+        // Списки в отображённом файле не входят в total: это страничный кэш, а не куча
+        std::cout << "  " << std::left << std::setw(20) << "posting file (mmap)" << std::right << std::setw(14)
+                  << report.posting_mapped << "\n";
+    }
+    std::cout << "Largest terms:\n";
+    for (const auto &term : report.largest_terms) {
+        std::cout << "  " << std::left << std::setw(20) << term.term << std::right << std::setw(14) << term.bytes
+                  << "  " << term.postings << " postings\n";
+    }
+    std::cout << std::defaultfloat << std::flush;
+}
+
+/**
+ * Пакетный режим: requests.json -> answers.json.
+ */
+void RunBatch(ConverterJSON &converter, const Config &config, SearchServer &srv) {
+    // Чтение запросов, поиск и запись ответов идут конвейером.
+    // Файл ответов создаётся только после того, как requests.json
+    // начал успешно читаться (первый ответ или пустой список запросов)
+    std::unique_ptr<AnswersWriter> writer;
+    PipelineOptions pipeline_options;
+    pipeline_options.search_threads = config.threads;
+    pipeline_options.queue_capacity = config.queue_capacity;
+    SearchPipeline pipeline(srv, pipeline_options);
+    pipeline.Run(
+        [&converter](const std::function<void(std::string &&)> &on_request) {
+            converter.StreamRequests(on_request);
+        },
+        [&writer, &converter](size_t, std::vector<RelativeIndex> &&row) {
+            // Преобразуем в пары (doc_id, rank)
+            std::vector<std::pair<int, float>> answer;
+            answer.reserve(row.size());
             for (auto &item : row) {
-                temp.push_back({(int)item.doc_id, item.rank});
+                answer.push_back({(int)item.doc_id, item.rank});
+            }
+            if (!writer) {
+                writer = converter.MakeAnswersWriter();
             }
-            answers.push_back(temp);
+            writer->Write(answer);
+        });
+    if (!writer) {
+        writer = converter.MakeAnswersWriter();
+    }
+    writer->Finish();
+}
+
+/**
+ * Трассировка запросов requests.json: по строке JSON на запрос
+ * ({"request": 0, "query": "...", "explain": {...}}). Запросы выполняются
+ * повторно в режиме explain.
+ */
+void WriteExplain(ConverterJSON &converter, const SearchServer &srv, const std::string &path) {
+    std::ofstream out(path, std::ios::binary);
+    size_t index = 0;
+    converter.StreamRequests([&](std::string &&query) {
+        QueryOptions options = srv.DefaultOptions(srv.GetMaxResponses());
+        options.explain = true;
+        QueryResult result = srv.Search(query, options);
+        nlohmann::json line = {{"request", index++}, {"query", query}, {"explain", ExplainToJson(*result.explain)}};
+        if (result.partial) {
+            line["partial"] = true;
         }
+        out << line.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) << '\n';
+    });
+    if (!out) {
+        throw std::runtime_error("cannot write explain output to " + path);
+    }
+}
 
-        // Выводим в answers.json
-        converter.putAnswers(answers);
+/**
+ * Запускает сервер (QueryServer или HttpServer) и работает до SIGINT/SIGTERM.
+ * Индекс всё это время остаётся в памяти.
+ */
+template <typename Server, typename Options>
+void ServeUntilSignal(const SearchServer &srv, const Options &options, const std::string &address) {
+#ifndef _WIN32
+    // Сигналы блокируются до создания потоков сервера (они наследуют маску)
+    // и принимаются отдельным потоком через sigwait
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+#endif
+    Server server(srv, options);
+    server.Listen(SocketAddress::Parse(address));
+    std::cout << "Listening on " << address << std::endl;
+#ifndef _WIN32
+    std::thread waiter([&server, signals]() {
+        int sig = 0;
+        sigwait(&signals, &sig);
+        server.Stop();
+    });
+    try {
+        server.Run();
+    } catch (...) {
+        kill(getpid(), SIGTERM);
+        waiter.join();
+        throw;
+    }
+    kill(getpid(), SIGTERM);
+    waiter.join();
+#else
+    server.Run();
+#endif
+}
+
+/**
+ * Сохраняет метрики процесса: JSON, если имя оканчивается на .json,
+ * иначе текстовый формат Prometheus.
+ */
+void WriteMetrics(const std::string &path) {
+    bool as_json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    std::ofstream out(path, std::ios::binary);
+    out << (as_json ? Metrics().DumpJson() + "\n" : Metrics().DumpPrometheus());
+    if (!out) {
+        throw std::runtime_error("cannot write metrics to " + path);
+    }
+}
+
+void PrintUsage() {
+    std::cerr << "Usage: search_engine [--serve <address> | --http <address>] [--metrics <file>]\n"
+              << "                     [--explain <file>] [--memory-report] [--document <docid>]\n"
+              << "  address: port, host:port or unix:/path\n"
+              << "  --serve accepts only loopback or unix addresses; --http binds to any address\n"
+              << "  and has no authentication, so expose it only behind a trusted proxy\n"
+              << "  --metrics: write metrics on exit (Prometheus text, JSON for *.json)\n"
+              << "  --explain: batch mode, write a per-term execution trace of every request\n"
+              << "  --memory-report: print index memory usage per structure and the largest terms\n"
+              << "  --document: print a document from document_store and exit" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::string serve_address;
+    std::string http_address;
+    std::string metrics_path;
+    std::string explain_path;
+    bool memory_report = false;
+    long long document_id = -1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--serve" && i + 1 < argc) {
+            serve_address = argv[++i];
+        } else if (arg == "--http" && i + 1 < argc) {
+            http_address = argv[++i];
+        } else if (arg == "--metrics" && i + 1 < argc) {
+            metrics_path = argv[++i];
+        } else if (arg == "--explain" && i + 1 < argc) {
+            explain_path = argv[++i];
+        } else if (arg == "--memory-report") {
+            memory_report = true;
+        } else if (arg == "--document" && i + 1 < argc) {
+            char *end = nullptr;
+            document_id = std::strtoll(argv[++i], &end, 10);
+            if (*end != '\0' || document_id < 0) {
+                PrintUsage();
+                return 2;
+            }
+        } else {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    try {
+        // config.json читается один раз, дальше настройки передаются компонентам
+        ConverterJSON converter;
+        const Config &config = converter.GetConfig();
+
+        if (document_id >= 0) {
+            // Текст документа из хранилища, без индексации
+            if (config.document_store.empty()) {
+                throw std::runtime_error("document_store is not set in config.json");
+            }
+            DocumentStore store(config.document_store, 1);
+            std::cout << store.Get(static_cast<size_t>(document_id)) << std::endl;
+            return 0;
+        }
+
+        // Индексируем документы
+        IndexOptions index_options;
+        index_options.threads = config.threads;
+        index_options.count_width = config.count_width;
+        index_options.temp_dir = config.temp_dir;
+        index_options.memory_budget = config.memory_budget_mb * 1024 * 1024;
+        index_options.positions = config.positions;
+        InvertedIndex idx(index_options);
+        BuildIndex(converter, config, idx);
+        if (memory_report) {
+            PrintMemoryReport(idx);
+        }
+
+        SearchServer srv(idx, static_cast<size_t>(config.max_responses));
+        srv.SetQueryLimits(std::chrono::milliseconds(config.query_timeout_ms), config.query_max_postings);
+        srv.SetQueryMode(config.query_mode);
+        SchedulerOptions scheduler_options;
+        scheduler_options.threads = config.threads;
+        scheduler_options.batch_threads = config.batch_threads;
+        scheduler_options.queue_capacity = config.queue_capacity;
+        scheduler_options.max_queued_cost = config.max_queued_postings;
+        if (!http_address.empty()) {
+            HttpServerOptions http_options;
+            http_options.scheduler = scheduler_options;
+            std::unique_ptr<DocumentStore> store;
+            if (!config.document_store.empty()) {
+                store = std::make_unique<DocumentStore>(config.document_store, config.document_cache_blocks);
+                http_options.documents = store.get();
+            }
+            ServeUntilSignal<HttpServer>(srv, http_options, http_address);
+        } else if (!serve_address.empty()) {
+            QueryServerOptions query_options;
+            query_options.scheduler = scheduler_options;
+            ServeUntilSignal<QueryServer>(srv, query_options, serve_address);
+        } else {
+            RunBatch(converter, config, srv);
+            if (!explain_path.empty()) {
+                WriteExplain(converter, srv, explain_path);
+            }
+        }
+        if (!metrics_path.empty()) {
+            WriteMetrics(metrics_path);
+        }
     } catch (const std::exception &ex) {
         std::cerr << "Error: " << ex.what() << std::endl;
         return 1;
@@ -0,0 +1,53 @@
+#include "mapped_file.h"
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+MappedFile::MappedFile(const std::string &path) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("cannot stat " + path);
+    }
+    _size = static_cast<size_t>(info.st_size);
+    if (_size > 0) {
+        void *mapping = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("cannot map " + path);
+        }
+        _mapping = mapping;
+        _data = static_cast<const char *>(mapping);
+    }
+    ::close(fd);
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    _buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    _size = _buffer.size();
+    _data = _size > 0 ? _buffer.data() : nullptr;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (_mapping) {
+        ::munmap(_mapping, _size);
+    }
+#endif
+}
@@ -0,0 +1,217 @@
+#include "metrics.h"
+#include "latency_histogram.h"
+#include <nlohmann/json.hpp>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+namespace metrics_detail {
+
+size_t ThreadShard() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed);
+    return shard;
+}
+
+} // namespace metrics_detail
+
+namespace {
+
+std::string FormatNumber(double value) {
+    if (std::isinf(value)) {
+        return value > 0 ? "+Inf" : "-Inf";
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+    return buffer;
+}
+
+std::string EscapeHelp(const std::string &text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '\\') {
+            out += "\\\\";
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+uint64_t Counter::Value() const {
+    uint64_t total = 0;
+    for (const auto &shard : _shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Histogram::Histogram(double scale)
+    : _scale(scale),
+      _buckets(LogLinearBucketCount(kSubBucketBits))
+{
+    for (auto &shard : _shards) {
+        shard.counts = std::make_unique<std::atomic<uint64_t>[]>(_buckets);
+        for (size_t i = 0; i < _buckets; i++) {
+            shard.counts[i].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void Histogram::Record(uint64_t value) {
+    auto &shard = _shards[metrics_detail::ThreadShard() % metrics_detail::kHistogramShards];
+    shard.counts[LogLinearBucketIndex(value, kSubBucketBits)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::Collect() const {
+    Snapshot snapshot;
+    snapshot.buckets = _buckets;
+    snapshot.counts = std::make_unique<uint64_t[]>(_buckets);
+    for (const auto &shard : _shards) {
+        for (size_t i = 0; i < _buckets; i++) {
+            uint64_t count = shard.counts[i].load(std::memory_order_relaxed);
+            snapshot.counts[i] += count;
+            // count берётся из корзин, чтобы сумма корзин с ним совпадала
+            snapshot.count += count;
+        }
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+uint64_t Histogram::Snapshot::ValueAtPercentile(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+    double clamped = percentile < 0 ? 0 : (percentile > 100 ? 100 : percentile);
+    uint64_t rank = static_cast<uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(count)));
+    rank = rank == 0 ? 1 : rank;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return LogLinearBucketUpperBound(i, kSubBucketBits);
+        }
+    }
+    return LogLinearBucketUpperBound(buckets - 1, kSubBucketBits);
+}
+
+MetricsRegistry::Entry &MetricsRegistry::Find(const std::string &name, const std::string &help,
+                                              Kind kind, double scale) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    for (auto &entry : _entries) {
+        if (entry.name == name) {
+            if (entry.kind != kind) {
+                throw std::logic_error("metric " + name + " is registered with another type");
+            }
+            return entry;
+        }
+    }
+    Entry &entry = _entries.emplace_back();
+    entry.name = name;
+    entry.help = help;
+    entry.kind = kind;
+    switch (kind) {
+        case Kind::Counter:
+            entry.counter = std::make_unique<Counter>();
+            break;
+        case Kind::Gauge:
+            entry.gauge = std::make_unique<Gauge>();
+            break;
+        case Kind::Histogram:
+            entry.histogram = std::make_unique<Histogram>(scale);
+            break;
+    }
+    return entry;
+}
+
+Counter &MetricsRegistry::GetCounter(const std::string &name, const std::string &help) {
+    return *Find(name, help, Kind::Counter, 1.0).counter;
+}
+
+Gauge &MetricsRegistry::GetGauge(const std::string &name, const std::string &help) {
+    return *Find(name, help, Kind::Gauge, 1.0).gauge;
+}
+
+Histogram &MetricsRegistry::GetHistogram(const std::string &name, const std::string &help, double scale) {
+    return *Find(name, help, Kind::Histogram, scale).histogram;
+}
+
+std::string MetricsRegistry::DumpPrometheus() const {
+    std::lock_guard<std::mutex> lock(_mtx);
+    std::string out;
+    for (const auto &entry : _entries) {
+        out += "# HELP " + entry.name + " " + EscapeHelp(entry.help) + "\n";
+        switch (entry.kind) {
+            case Kind::Counter:
+                out += "# TYPE " + entry.name + " counter\n";
+                out += entry.name + " " + std::to_string(entry.counter->Value()) + "\n";
+                break;
+            case Kind::Gauge:
+                out += "# TYPE " + entry.name + " gauge\n";
+                out += entry.name + " " + FormatNumber(entry.gauge->Value()) + "\n";
+                break;
+            case Kind::Histogram: {
+                out += "# TYPE " + entry.name + " histogram\n";
+                auto snapshot = entry.histogram->Collect();
+                double scale = entry.histogram->Scale();
+                // Выводятся только непустые корзины: границы le кумулятивны,
+                // поэтому пропуск пустых не меняет смысла
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i < snapshot.buckets; i++) {
+                    if (snapshot.counts[i] == 0) {
+                        continue;
+                    }
+                    cumulative += snapshot.counts[i];
+                    double le = static_cast<double>(LogLinearBucketUpperBound(i, Histogram::kSubBucketBits)) / scale;
+                    out += entry.name + "_bucket{le=\"" + FormatNumber(le) + "\"} " +
+                           std::to_string(cumulative) + "\n";
+                }
+                out += entry.name + "_bucket{le=\"+Inf\"} " + std::to_string(snapshot.count) + "\n";
+                out += entry.name + "_sum " + FormatNumber(static_cast<double>(snapshot.sum) / scale) + "\n";
+                out += entry.name + "_count " + std::to_string(snapshot.count) + "\n";
+                break;
+            }
+        }
+    }
+    return out;
+}
+
+std::string MetricsRegistry::DumpJson() const {
+    std::lock_guard<std::mutex> lock(_mtx);
+    nlohmann::json out = nlohmann::json::object();
+    for (const auto &entry : _entries) {
+        switch (entry.kind) {
+            case Kind::Counter:
+                out[entry.name] = entry.counter->Value();
+                break;
+            case Kind::Gauge:
+                out[entry.name] = entry.gauge->Value();
+                break;
+            case Kind::Histogram: {
+                auto snapshot = entry.histogram->Collect();
+                double scale = entry.histogram->Scale();
+                out[entry.name] = {
+                    {"count", snapshot.count},
+                    {"sum", static_cast<double>(snapshot.sum) / scale},
+                    {"p50", static_cast<double>(snapshot.ValueAtPercentile(50)) / scale},
+                    {"p99", static_cast<double>(snapshot.ValueAtPercentile(99)) / scale},
+                    {"p999", static_cast<double>(snapshot.ValueAtPercentile(99.9)) / scale},
+                };
+                break;
+            }
+        }
+    }
+    return out.dump(2);
+}
+
+MetricsRegistry &Metrics() {
+    static MetricsRegistry registry;
+    return registry;
+}
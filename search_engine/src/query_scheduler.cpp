@@ -0,0 +1,122 @@
+#include "query_scheduler.h"
+#include <algorithm>
+#include <iostream>
+#include "parallel.h"
+#include "metrics.h"
+
+QueryScheduler::QueryScheduler(const SearchServer &server, const SchedulerOptions &options)
+    : _server(server),
+      _queue_capacity(std::max<size_t>(options.queue_capacity, 1)),
+      _max_queued_cost(options.max_queued_cost)
+{
+    size_t count = ResolveThreadCount(options.threads, SIZE_MAX);
+    _batch_threads = options.batch_threads > 0 ? std::min(options.batch_threads, count)
+                                               : std::max<size_t>(count / 2, 1);
+    _threads.reserve(count);
+    for (size_t t = 0; t < count; t++) {
+        _threads.emplace_back([this]() { Work(); });
+    }
+}
+
+QueryScheduler::~QueryScheduler() {
+    Shutdown();
+}
+
+bool QueryScheduler::Submit(std::string query, const QueryOptions &options, QueryPriority priority, Callback done) {
+    // Оценка стоимости - объём списков вхождений для режима запроса, но не больше бюджета
+    size_t cost = _server.EstimateCost(query, options.mode);
+    if (options.max_postings > 0) {
+        cost = std::min(cost, options.max_postings);
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        auto &queue = priority == QueryPriority::Interactive ? _interactive : _batch;
+        // Единственный запрос допускается при любой стоимости, иначе тяжёлый
+        // запрос нельзя было бы выполнить даже на свободном сервере
+        bool over_cost = _max_queued_cost > 0 && _queued_cost > 0 && _queued_cost + cost > _max_queued_cost;
+        if (_stopping || queue.size() >= _queue_capacity || over_cost) {
+            _rejected.fetch_add(1, std::memory_order_relaxed);
+            static Counter &rejected = Metrics().GetCounter(
+                "search_engine_rejected_queries_total", "Queries rejected by admission control");
+            rejected.Add();
+            return false;
+        }
+        queue.push_back({std::move(query), options, cost, std::move(done)});
+        _queued_cost += cost;
+    }
+    _accepted.fetch_add(1, std::memory_order_relaxed);
+    _ready.notify_all();
+    return true;
+}
+
+void QueryScheduler::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if (_stopping) {
+            return;
+        }
+        _stopping = true;
+    }
+    _ready.notify_all();
+    for (auto &thread : _threads) {
+        thread.join();
+    }
+}
+
+SchedulerStats QueryScheduler::Stats() const {
+    SchedulerStats stats;
+    stats.accepted = _accepted.load(std::memory_order_relaxed);
+    stats.rejected = _rejected.load(std::memory_order_relaxed);
+    stats.completed = _completed.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void QueryScheduler::Work() {
+    for (;;) {
+        Job job;
+        bool batch = false;
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            _ready.wait(lock, [this]() {
+                return !_interactive.empty() || (!_batch.empty() && _batch_running < _batch_threads) ||
+                       (_stopping && _batch.empty());
+            });
+            if (!_interactive.empty()) {
+                job = std::move(_interactive.front());
+                _interactive.pop_front();
+            } else if (!_batch.empty()) {
+                job = std::move(_batch.front());
+                _batch.pop_front();
+                batch = true;
+                _batch_running++;
+            } else {
+                return;
+            }
+            _queued_cost -= job.cost;
+        }
+        QueryResult result;
+        try {
+            result = _server.Search(job.query, job.options);
+        } catch (const std::exception &ex) {
+            // Вызывающий всё равно получает ответ, иначе клиент ждал бы его вечно
+            std::cerr << "Error: " << ex.what() << std::endl;
+            result.partial = true;
+        }
+        try {
+            job.done(std::move(result));
+        } catch (const std::exception &ex) {
+            // Ошибка обработчика ответа не должна останавливать поток планировщика
+            std::cerr << "Error: " << ex.what() << std::endl;
+        }
+        _completed.fetch_add(1, std::memory_order_relaxed);
+        if (batch) {
+            {
+                std::lock_guard<std::mutex> lock(_mtx);
+                _batch_running--;
+            }
+            // Будятся все: ждущие могут спать и при непустой пакетной очереди,
+            // а после её опустошения при _stopping каждый должен выйти
+            _ready.notify_all();
+        }
+    }
+}
@@ -0,0 +1,270 @@
+#include "query_server.h"
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <future>
+#include <iostream>
+#include <algorithm>
+#include "explain_json.h"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+using json = nlohmann::json;
+
+namespace {
+
+// Наибольший срок клиента, мс (9 цифр, как в параметре timeout_ms HTTP)
+const uint64_t kMaxTimeoutMs = 999999999;
+
+} // namespace
+
+QueryServer::QueryServer(const SearchServer &server, const QueryServerOptions &options)
+    : _server(server), _options(options), _scheduler(server, options.scheduler)
+{}
+
+QueryServer::~QueryServer() {
+    Stop();
+    if (_listen_fd >= 0) {
+        CloseSocket(_listen_fd);
+    }
+    if (!_unix_path.empty()) {
+        RemoveUnixSocket(_unix_path);
+    }
+}
+
+void QueryServer::Listen(const SocketAddress &address) {
+    // Протокол без аутентификации: только локальные подключения
+    if (!address.IsLoopback()) {
+        throw std::runtime_error("query server listens only on loopback or unix addresses, got " + address.host);
+    }
+    _listen_fd = ListenSocket(address, _options.backlog);
+    if (address.IsUnix()) {
+        _unix_path = address.unix_path;
+    } else {
+        _port = LocalPort(_listen_fd);
+    }
+}
+
+std::string QueryServer::HandleLine(const std::string &line) {
+    json response;
+    try {
+        json request = json::parse(line);
+        if (!request.is_object() || !request.contains("query") || !request["query"].is_string()) {
+            throw std::runtime_error("request must be an object with string field \"query\"");
+        }
+        if (request.contains("id")) {
+            response["id"] = request["id"];
+        }
+        QueryOptions options = _server.DefaultOptions(_server.GetMaxResponses());
+        if (request.contains("k")) {
+            if (!request["k"].is_number_unsigned()) {
+                throw std::runtime_error("\"k\" must be a non-negative integer");
+            }
+            options.limit = request["k"].get<size_t>();
+        }
+        if (request.contains("timeout_ms")) {
+            if (!request["timeout_ms"].is_number_unsigned()) {
+                throw std::runtime_error("\"timeout_ms\" must be a non-negative integer");
+            }
+            // Срок клиента может только сократить срок сервера (query_timeout_ms).
+            // Как и в HTTP, не больше 9 цифр: иначе milliseconds и now() + срок переполнятся
+            uint64_t timeout_ms = std::min<uint64_t>(request["timeout_ms"].get<uint64_t>(), kMaxTimeoutMs);
+            options.deadline = std::min(options.deadline, std::chrono::steady_clock::now() +
+                               std::chrono::milliseconds(timeout_ms));
+        }
+        if (request.contains("explain")) {
+            if (!request["explain"].is_boolean()) {
+                throw std::runtime_error("\"explain\" must be a boolean");
+            }
+            options.explain = request["explain"].get<bool>();
+        }
+        if (request.contains("mode")) {
+            if (request["mode"] == "and") {
+                options.mode = QueryMode::And;
+            } else if (request["mode"] == "or") {
+                options.mode = QueryMode::Or;
+            } else {
+                throw std::runtime_error("\"mode\" must be \"and\" or \"or\"");
+            }
+        }
+        QueryPriority priority = QueryPriority::Interactive;
+        if (request.contains("priority")) {
+            if (request["priority"] == "batch") {
+                priority = QueryPriority::Batch;
+            } else if (request["priority"] != "interactive") {
+                throw std::runtime_error("\"priority\" must be \"interactive\" or \"batch\"");
+            }
+        }
+        std::promise<QueryResult> promise;
+        auto future = promise.get_future();
+        bool accepted = _scheduler.Submit(request["query"].get<std::string>(), options, priority,
+                                          [&promise](QueryResult &&result) {
+            promise.set_value(std::move(result));
+        });
+        if (!accepted) {
+            throw std::runtime_error("server is overloaded");
+        }
+        QueryResult query_result = future.get();
+        const auto &results = query_result.items;
+        response["result"] = !results.empty();
+        if (query_result.partial) {
+            response["partial"] = true;
+        }
+        if (!results.empty()) {
+            json relevance = json::array();
+            for (auto &item : results) {
+                relevance.push_back({{"docid", item.doc_id}, {"rank", item.rank}});
+            }
+            response["relevance"] = relevance;
+        }
+        if (query_result.explain) {
+            response["explain"] = ExplainToJson(*query_result.explain);
+        }
+    } catch (const std::exception &ex) {
+        json error;
+        if (response.contains("id")) {
+            error["id"] = response["id"];
+        }
+        error["error"] = ex.what();
+        // Сообщение парсера может содержать байты некорректного UTF-8 из запроса
+        return error.dump(-1, ' ', false, json::error_handler_t::replace);
+    }
+    return response.dump(-1, ' ', false, json::error_handler_t::replace);
+}
+
+#ifndef _WIN32
+
+void QueryServer::Run() {
+    if (_listen_fd < 0) {
+        throw std::runtime_error("QueryServer::Listen must be called before Run");
+    }
+    while (!_stopping.load()) {
+        int fd = ::accept(_listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (_stopping.load()) {
+                break;
+            }
+            throw std::runtime_error("accept failed");
+        }
+        std::lock_guard<std::mutex> lock(_mtx);
+        ReapFinished();
+        if (_stopping.load() || _connections.size() >= _options.max_connections) {
+            WriteAll(fd, "{\"error\":\"too many connections\"}\n");
+            CloseSocket(fd);
+            continue;
+        }
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        Connection &ref = *connection;
+        connection->thread = std::thread([this, &ref]() { Serve(ref); });
+        _connections.push_back(std::move(connection));
+    }
+}
+
+void QueryServer::Serve(Connection &connection) {
+    // Ошибка одного соединения закрывает только его, а не весь процесс
+    try {
+        std::string buffer;
+        char chunk[16 * 1024];
+        bool open = true;
+        while (open) {
+            ssize_t n = ::recv(connection.fd, chunk, sizeof(chunk), 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            buffer.append(chunk, static_cast<size_t>(n));
+            // Отвечаем на все полные строки; ответы на несколько строк
+            // одного пакета отправляются одним вызовом
+            std::string output;
+            size_t start = 0;
+            for (size_t end; (end = buffer.find('\n', start)) != std::string::npos; start = end + 1) {
+                std::string line = buffer.substr(start, end - start);
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                if (line.empty()) {
+                    continue;
+                }
+                output += HandleLine(line);
+                output += '\n';
+            }
+            buffer.erase(0, start);
+            if (buffer.size() > _options.max_line_length) {
+                output += "{\"error\":\"request line is too long\"}\n";
+                open = false;
+            }
+            if (!output.empty() && !WriteAll(connection.fd, output)) {
+                break;
+            }
+        }
+    } catch (const std::exception &ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+    }
+    // Сокет закрывается сразу, чтобы клиент увидел конец соединения, не
+    // дожидаясь следующего accept. Под _mtx: Stop() вызывает shutdown только
+    // для открытых дескрипторов и не заденет уже переиспользованный номер
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        CloseSocket(connection.fd);
+        connection.fd = -1;
+    }
+    connection.done.store(true);
+}
+
+void QueryServer::ReapFinished() {
+    for (auto it = _connections.begin(); it != _connections.end();) {
+        if ((*it)->done.load()) {
+            (*it)->thread.join();
+            it = _connections.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void QueryServer::Stop() {
+    if (_stopping.exchange(true)) {
+        return;
+    }
+    if (_listen_fd >= 0) {
+        ShutdownSocket(_listen_fd);
+    }
+    std::list<std::unique_ptr<Connection>> connections;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        for (auto &connection : _connections) {
+            if (connection->fd >= 0) {
+                ShutdownSocket(connection->fd);
+            }
+        }
+        connections.swap(_connections);
+    }
+    for (auto &connection : connections) {
+        connection->thread.join();
+    }
+}
+
+#else
+
+void QueryServer::Run() {
+    throw std::runtime_error("server mode is not supported on this platform");
+}
+
+void QueryServer::Serve(Connection &) {}
+
+void QueryServer::ReapFinished() {}
+
+void QueryServer::Stop() {
+    _stopping.store(true);
+}
+
+#endif
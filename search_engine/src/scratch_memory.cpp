@@ -0,0 +1,24 @@
+#include "scratch_memory.h"
+#include <algorithm>
+
+CountingMemoryResource::CountingMemoryResource(std::pmr::memory_resource *upstream)
+    : _upstream(upstream)
+{}
+
+void *CountingMemoryResource::do_allocate(size_t bytes, size_t alignment) {
+    void *p = _upstream->allocate(bytes, alignment);
+    _stats.allocations++;
+    _stats.bytes_allocated += bytes;
+    _stats.bytes_in_use += bytes;
+    _stats.peak_bytes_in_use = std::max(_stats.peak_bytes_in_use, _stats.bytes_in_use);
+    return p;
+}
+
+void CountingMemoryResource::do_deallocate(void *p, size_t bytes, size_t alignment) {
+    _upstream->deallocate(p, bytes, alignment);
+    _stats.bytes_in_use -= bytes;
+}
+
+bool CountingMemoryResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+    return this == &other;
+}
@@ -0,0 +1,128 @@
+#include "search_pipeline.h"
+#include <thread>
+#include <atomic>
+#include <map>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+#include "bounded_queue.h"
+#include "parallel.h"
+
+namespace {
+
+struct RequestItem {
+    size_t index = 0;
+    std::string query;
+};
+
+struct AnswerItem {
+    size_t index = 0;
+    std::vector<RelativeIndex> answer;
+};
+
+} // namespace
+
+SearchPipeline::SearchPipeline(const SearchServer &server, const PipelineOptions &options)
+    : _server(server), _options(options)
+{}
+
+size_t SearchPipeline::Run(const RequestSource &source, const AnswerSink &sink) {
+    size_t capacity = std::max<size_t>(_options.queue_capacity, 2);
+    size_t search_threads = ResolveThreadCount(_options.search_threads, SIZE_MAX);
+    // Сколько запросов может быть одновременно "в работе" (прочитан, но не записан):
+    // ограничивает и буфер переупорядочивания на стадии записи
+    size_t window = capacity * 2 + search_threads;
+
+    BoundedQueue<RequestItem> requests(capacity);
+    BoundedQueue<AnswerItem> answers(capacity);
+    std::atomic<size_t> written{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mtx;
+
+    auto fail = [&](std::exception_ptr e) {
+        {
+            std::lock_guard<std::mutex> lock(error_mtx);
+            if (!error) {
+                error = e;
+            }
+        }
+        failed.store(true);
+        requests.Close();
+        answers.Close();
+    };
+
+    // Стадия 1: чтение запросов
+    std::atomic<size_t> total{0};
+    std::thread reader([&]() {
+        try {
+            size_t index = 0;
+            source([&](std::string &&query) {
+                Backoff backoff;
+                while (index - written.load(std::memory_order_acquire) >= window) {
+                    if (failed.load()) {
+                        throw std::runtime_error("pipeline stopped");
+                    }
+                    backoff.Pause();
+                }
+                if (!requests.Push({index, std::move(query)})) {
+                    throw std::runtime_error("pipeline stopped");
+                }
+                index++;
+            });
+            total.store(index);
+            requests.Close();
+        } catch (...) {
+            fail(std::current_exception());
+        }
+    });
+
+    // Стадия 2: параллельный поиск
+    std::atomic<size_t> active_searchers{search_threads};
+    std::vector<std::thread> searchers;
+    for (size_t t = 0; t < search_threads; t++) {
+        searchers.emplace_back([&]() {
+            try {
+                RequestItem item;
+                while (requests.Pop(item)) {
+                    if (!answers.Push({item.index, _server.SearchQuery(item.query)})) {
+                        break;
+                    }
+                }
+            } catch (...) {
+                fail(std::current_exception());
+            }
+            if (--active_searchers == 0) {
+                answers.Close();
+            }
+        });
+    }
+
+    // Стадия 3: запись ответов по порядку номеров (в текущем потоке)
+    try {
+        std::map<size_t, std::vector<RelativeIndex>> pending;
+        size_t next = 0;
+        AnswerItem item;
+        while (answers.Pop(item)) {
+            pending.emplace(item.index, std::move(item.answer));
+            while (!pending.empty() && pending.begin()->first == next) {
+                sink(next, std::move(pending.begin()->second));
+                pending.erase(pending.begin());
+                written.store(++next, std::memory_order_release);
+            }
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+
+    reader.join();
+    for (auto &t : searchers) {
+        t.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return total.load();
+}
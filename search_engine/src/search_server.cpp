@@ -1,72 +1,642 @@
 #include "search_server.h"
-#include <unordered_map>
+#include <cstdint>
 #include <algorithm>
+#include <functional>
 #include <cmath>
-#include <sstream>
+#include "text_normalizer.h"
+#include "metrics.h"
+
+namespace {
+
+/**
+ * Список вхождений слова запроса; position - номер слова в трассировке.
+ * precomputed - список фразы из MatchPhrase: его стоимость уже списана
+ * из бюджета, поэтому при подсчёте срок и бюджет для него не проверяются.
+ */
+struct TermList {
+    PostingsView postings;
+    size_t position;
+    bool precomputed;
+};
+
+/**
+ * Найденные вхождения фразы в формате списка вхождений: документы
+ * по возрастанию и число вхождений фразы в каждый.
+ */
+struct PhrasePostings {
+    std::vector<uint32_t> doc_ids;
+    std::vector<uint32_t> counts;
+
+    PostingsView View() const {
+        return {doc_ids.data(), nullptr, counts.data(), doc_ids.size()};
+    }
+};
+
+// Ячеек релевантности, которые поток держит между запросами (16 МБ);
+// больший массив освобождается сразу после запроса
+const size_t kRetainedRelevance = size_t(1) << 22;
+
+/**
+ * Рабочие буферы поиска, свои у каждого потока: абсолютная релевантность
+ * и список затронутых документов (только они и обнуляются). Массив
+ * релевантности покрывает лишь диапазон doc_id кандидатов запроса:
+ * документ doc_id хранится в doc_relevance[doc_id - base].
+ * Фразы запроса вычисляются в phrases и дальше считаются как обычные списки.
+ */
+struct SearchScratch {
+    std::vector<uint32_t> doc_relevance;
+    uint32_t base = 0;
+    std::vector<uint32_t> touched;
+    std::vector<TermList> lists;
+    std::vector<uint32_t> top;
+    std::vector<PhrasePostings> phrases;
+    std::vector<std::string> phrase_words;
+    std::vector<size_t> found;
+    std::vector<size_t> reads;
+
+    uint32_t &Relevance(uint32_t doc_id) { return doc_relevance[doc_id - base]; }
+};
+
+thread_local SearchScratch scratch;
+
+/**
+ * Освобождает массив релевантности после запроса, если запрос
+ * растянул его больше kRetainedRelevance ячеек.
+ */
+struct RelevanceRelease {
+    ~RelevanceRelease() {
+        if (scratch.doc_relevance.capacity() > kRetainedRelevance) {
+            std::vector<uint32_t>().swap(scratch.doc_relevance);
+        }
+    }
+};
+
+// Сумма счётчиков с насыщением на UINT32_MAX
+uint32_t AddSaturated(uint32_t sum, uint64_t count) {
+    uint64_t total = sum + count;
+    return total > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(total);
+}
+
+/**
+ * Метрики поиска; регистрируются при первом запросе.
+ */
+struct SearchMetrics {
+    Counter &queries = Metrics().GetCounter(
+        "search_engine_queries_total", "Search queries served");
+    Counter &partial = Metrics().GetCounter(
+        "search_engine_partial_queries_total", "Queries stopped by deadline or posting budget");
+    Counter &postings = Metrics().GetCounter(
+        "search_engine_postings_scanned_total", "Postings scored by search queries");
+    Histogram &latency = Metrics().GetHistogram(
+        "search_engine_query_duration_seconds", "Search latency", 1e9);
+};
+
+SearchMetrics &GetSearchMetrics() {
+    static SearchMetrics metrics;
+    return metrics;
+}
+
+std::chrono::nanoseconds Since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+}
+
+/**
+ * Абсолютная релевантность k-го лучшего из затронутых документов.
+ */
+uint64_t TopKThreshold(size_t k) {
+    auto &top = scratch.top;
+    if (k == 0 || scratch.touched.size() < k) {
+        return 0;
+    }
+    top.clear();
+    for (uint32_t doc_id : scratch.touched) {
+        top.push_back(scratch.Relevance(doc_id));
+    }
+    std::nth_element(top.begin(), top.begin() + static_cast<std::ptrdiff_t>(k - 1), top.end(), std::greater<uint32_t>());
+    return top[k - 1];
+}
+
+/**
+ * Разбирает запрос: слова вне кавычек передаются в on_word(word), текст
+ * в кавычках - в on_phrase(text, slop). Сразу после закрывающей кавычки
+ * может стоять ~k: между соседними словами фразы допускается до k других
+ * слов (без него slop = 0, слова подряд). Незакрытая кавычка действует
+ * до конца запроса.
+ */
+template <typename W, typename P>
+void ForEachQueryPart(std::string_view query, W &&on_word, P &&on_phrase) {
+    size_t i = 0;
+    while (i < query.size()) {
+        size_t open = query.find('"', i);
+        ForEachToken(query.substr(i, open == std::string_view::npos ? std::string_view::npos : open - i), on_word);
+        if (open == std::string_view::npos) {
+            break;
+        }
+        size_t close = query.find('"', open + 1);
+        std::string_view text = query.substr(open + 1, close == std::string_view::npos ?
+                                                       std::string_view::npos : close - open - 1);
+        i = close == std::string_view::npos ? query.size() : close + 1;
+        size_t slop = 0;
+        if (i + 1 < query.size() && query[i] == '~' && query[i + 1] >= '0' && query[i + 1] <= '9') {
+            for (i++; i < query.size() && query[i] >= '0' && query[i] <= '9'; i++) {
+                slop = std::min<size_t>(slop * 10 + static_cast<size_t>(query[i] - '0'), UINT32_MAX);
+            }
+        }
+        on_phrase(text, slop);
+    }
+}
+
+/**
+ * Нормализованная запись фразы: "слова через пробел" и ~k при k > 0.
+ * Служит именем фразы в трассировке.
+ */
+std::string PhraseKey(const std::vector<std::string> &words, size_t slop) {
+    std::string key = "\"";
+    for (size_t w = 0; w < words.size(); w++) {
+        if (w > 0) {
+            key.push_back(' ');
+        }
+        key += words[w];
+    }
+    key.push_back('"');
+    if (slop > 0) {
+        key += "~" + std::to_string(slop);
+    }
+    return key;
+}
+
+/**
+ * Находит документы, где слова фразы идут по порядку и между соседними
+ * не больше slop других слов; счётчик документа - число таких цепочек
+ * (по позициям последнего слова). Кандидаты - пересечение списков вхождений,
+ * которое ведёт самый короткий список; позиции читаются только у кандидатов.
+ * Без позиционного индекса фраза вырождается в пересечение слов,
+ * а счётчик - в минимум их счётчиков.
+ * Каждое вхождение ведущего списка списывается из бюджета (scored), срок
+ * проверяется перед каждым из них. Возвращает false, если поиск прерван:
+ * в out остаются совпадения, найденные до остановки.
+ */
+bool MatchPhrase(const InvertedIndex &index, const std::vector<std::string> &words, size_t slop,
+                 const QueryOptions &options, size_t &scored, size_t &position_bytes, PhrasePostings &out) {
+    out.doc_ids.clear();
+    out.counts.clear();
+    const size_t n = words.size();
+    std::vector<PostingsView> postings(n);
+    size_t driver = 0;
+    for (size_t w = 0; w < n; w++) {
+        postings[w] = index.GetPostings(words[w]);
+        if (postings[w].empty()) {
+            return true;
+        }
+        if (postings[w].size < postings[driver].size) {
+            driver = w;
+        }
+    }
+    std::vector<PositionCursor> cursors;
+    if (index.HasPositions()) {
+        for (size_t w = 0; w < n; w++) {
+            cursors.emplace_back(index.GetPositions(words[w]));
+        }
+    }
+    const bool has_deadline = options.deadline != std::chrono::steady_clock::time_point::max();
+    const size_t budget = options.max_postings > 0 ? options.max_postings : SIZE_MAX;
+    // found[w] - номер вхождения текущего документа в списке слова w
+    std::vector<size_t> found(n, 0);
+    std::vector<uint32_t> reachable;
+    std::vector<uint32_t> advanced;
+    std::vector<uint32_t> positions;
+    const PostingsView &base = postings[driver];
+    bool complete = true;
+    bool exhausted = false;
+    for (size_t i = 0; i < base.size && !exhausted; i++) {
+        if (scored >= budget || (has_deadline && std::chrono::steady_clock::now() >= options.deadline)) {
+            complete = false;
+            break;
+        }
+        scored++;
+        uint32_t doc_id = base.doc_ids[i];
+        bool all = true;
+        for (size_t w = 0; w < n && all; w++) {
+            const PostingsView &list = postings[w];
+            found[w] = GallopLowerBound(list.doc_ids, list.size, found[w], doc_id);
+            if (found[w] == list.size) {
+                // Список слова кончился - дальше совпадений нет
+                exhausted = true;
+                all = false;
+            } else {
+                all = list.doc_ids[found[w]] == doc_id;
+            }
+        }
+        if (!all) {
+            continue;
+        }
+        uint32_t count = UINT32_MAX;
+        if (cursors.empty()) {
+            for (size_t w = 0; w < n; w++) {
+                count = std::min(count, postings[w].Count(found[w]));
+            }
+        } else {
+            // reachable - позиции слова w, до которых дотягивается цепочка слов 0..w
+            cursors[0].Read(found[0], reachable);
+            for (size_t w = 1; w < n && !reachable.empty(); w++) {
+                cursors[w].Read(found[w], positions);
+                advanced.clear();
+                size_t j = 0;
+                for (uint32_t position : positions) {
+                    while (j < reachable.size() && uint64_t(reachable[j]) + 1 + slop < position) {
+                        j++;
+                    }
+                    if (j < reachable.size() && reachable[j] < position) {
+                        advanced.push_back(position);
+                    }
+                }
+                reachable.swap(advanced);
+            }
+            count = static_cast<uint32_t>(reachable.size());
+        }
+        if (count > 0) {
+            out.doc_ids.push_back(doc_id);
+            out.counts.push_back(count);
+        }
+    }
+    for (auto &cursor : cursors) {
+        position_bytes += cursor.BytesRead();
+    }
+    return complete;
+}
+
+/**
+ * Режим And: пересекает списки (lists отсортированы по длине) и записывает
+ * сумму счётчиков совпавших документов в scratch.Relevance/touched.
+ * Обходится самый короткий список блоками по SearchServer::kBlockSize
+ * с проверкой срока и бюджета, в остальных документ ищется галопом от
+ * предыдущей найденной позиции. Более короткие списки проверяются первыми,
+ * чтобы отсеять документ как можно раньше. Если первым идёт список фразы,
+ * срок и бюджет не проверяются: они уже учтены в MatchPhrase.
+ * Возвращает просмотренные вхождения короткого списка.
+ */
+size_t IntersectLists(const std::vector<TermList> &lists, const QueryOptions &options,
+                      QueryResult &result, QueryExplain *explain) {
+    const bool limited = !lists[0].precomputed;
+    const bool has_deadline = limited && options.deadline != std::chrono::steady_clock::time_point::max();
+    const size_t budget = limited && options.max_postings > 0 ? options.max_postings : SIZE_MAX;
+    const size_t block_size = SearchServer::kBlockSize;
+    auto started = explain ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    auto &found = scratch.found;
+    auto &reads = scratch.reads;
+    found.assign(lists.size(), 0);
+    reads.assign(lists.size(), 0);
+    const PostingsView &driver = lists[0].postings;
+    size_t scored = 0;
+    size_t blocks = 0;
+    bool exhausted = false;
+    for (size_t begin = 0; begin < driver.size && !exhausted;) {
+        if (scored >= budget || (has_deadline && std::chrono::steady_clock::now() >= options.deadline)) {
+            result.partial = true;
+            break;
+        }
+        size_t end = begin + std::min({driver.size - begin, block_size, budget - scored});
+        for (size_t i = begin; i < end; i++) {
+            uint32_t doc_id = driver.doc_ids[i];
+            uint64_t sum = driver.Count(i);
+            size_t t = 1;
+            for (; t < lists.size(); t++) {
+                const PostingsView &list = lists[t].postings;
+                found[t] = GallopLowerBound(list.doc_ids, list.size, found[t], doc_id);
+                if (found[t] == list.size) {
+                    // Один из списков кончился - дальше пересечение пусто
+                    exhausted = true;
+                    end = i + 1;
+                    break;
+                }
+                if (list.doc_ids[found[t]] != doc_id) {
+                    break;
+                }
+                sum += list.Count(found[t]);
+                reads[t]++;
+            }
+            if (t == lists.size()) {
+                scratch.Relevance(doc_id) = AddSaturated(0, sum);
+                scratch.touched.push_back(doc_id);
+            }
+        }
+        scored += end - begin;
+        blocks++;
+        begin = end;
+    }
+    if (explain) {
+        for (size_t t = 0; t < lists.size(); t++) {
+            const PostingsView &list = lists[t].postings;
+            TermExplain &term = explain->terms[lists[t].position];
+            size_t entry_bytes = sizeof(uint32_t) + (list.counts16 ? sizeof(uint16_t) : sizeof(uint32_t));
+            term.postings_scored = t == 0 ? scored : reads[t];
+            term.bytes_decoded = term.postings_scored * entry_bytes;
+        }
+        TermExplain &first = explain->terms[lists[0].position];
+        first.blocks_scanned = blocks;
+        first.blocks_skipped = (driver.size + block_size - 1) / block_size - blocks;
+        first.time = Since(started);
+        explain->thresholds.push_back({lists[0].position, scratch.touched.size(),
+                                       TopKThreshold(options.limit)});
+    }
+    return scored;
+}
+
+} // namespace
 
 bool RelativeIndex::operator==(const RelativeIndex &other) const {
     return doc_id == other.doc_id && std::fabs(rank - other.rank) < 1e-6;
 }
 
-SearchServer::SearchServer(InvertedIndex &idx)
-    : _index(idx)
+SearchServer::SearchServer(InvertedIndex &idx, size_t max_responses)
+    : _index(idx), _max_responses(max_responses)
 {}
 
+std::vector<std::vector<RelativeIndex>> SearchServer::search(const std::vector<std::string> &queries_input)
+{
+    std::vector<std::vector<RelativeIndex>> all_results;
+    all_results.reserve(queries_input.size());
+    for (auto &query : queries_input) {
+        all_results.push_back(SearchQuery(query));
+    }
+    return all_results;
+}
+
+std::vector<RelativeIndex> SearchServer::SearchQuery(const std::string &query) const
+{
+    return SearchQuery(query, _max_responses);
+}
+
+std::vector<RelativeIndex> SearchServer::SearchQuery(const std::string &query, size_t limit) const
+{
+    return Search(query, DefaultOptions(limit)).items;
+}
+
+size_t SearchServer::EstimateCost(const std::string &query, QueryMode mode) const
+{
+    size_t cost = 0;
+    size_t words = 0;
+    size_t shortest = SIZE_MAX;
+    auto add_word = [this, &cost, &words, &shortest](std::string_view word) {
+        size_t size = _index.GetPostings(std::string(word)).size;
+        cost += size;
+        words++;
+        shortest = std::min(shortest, size);
+    };
+    // Фраза стоит столько же, сколько все её слова: их списки пересекаются
+    ForEachQueryPart(query, add_word, [&add_word](std::string_view text, size_t) {
+        ForEachToken(text, add_word);
+    });
+    if (mode == QueryMode::And && words > 0) {
+        // Работа пересечения пропорциональна самому короткому списку
+        return std::min(cost, shortest * words);
+    }
+    return cost;
+}
+
+void SearchServer::SetQueryLimits(std::chrono::milliseconds timeout, size_t max_postings)
+{
+    _timeout = timeout;
+    _max_postings = max_postings;
+}
+
+QueryOptions SearchServer::DefaultOptions(size_t limit) const
+{
+    QueryOptions options;
+    options.limit = limit;
+    if (_timeout.count() > 0) {
+        options.deadline = std::chrono::steady_clock::now() + _timeout;
+    }
+    options.max_postings = _max_postings;
+    options.mode = _mode;
+    return options;
+}
+
+QueryResult SearchServer::Search(const std::string &query, const QueryOptions &options) const
+{
+    SearchMetrics &metrics = GetSearchMetrics();
+    auto started = std::chrono::steady_clock::now();
+    QueryResult result = Score(query, options);
+    metrics.queries.Add();
+    metrics.postings.Add(result.postings_scored);
+    if (result.partial) {
+        metrics.partial.Add();
+    }
+    auto elapsed = Since(started);
+    metrics.latency.Record(static_cast<uint64_t>(elapsed.count()));
+    if (result.explain) {
+        result.explain->total_time = elapsed;
+    }
+    return result;
+}
+
 /**
  * Метод поиска (частичное совпадение):
  *  - Суммируем count для всех слов запроса во всех документах.
  *  - Вычисляем max_abs.
  *  - Относительная релевантность = abs / max_abs.
  *  - Сортируем по убыванию rank, при равенстве doc_id.
- *  - Не обрезаем здесь: можно обрезать в main.cpp или здесь по требованию.
+ *  - Оставляем не более limit результатов.
+ *  Слова запроса нормализуются в GetPostings той же функцией NormalizeWord,
+ *  что и при индексации. Списки просматриваются от коротких к длинным;
+ *  срок и бюджет вхождений проверяются между блоками списка.
+ *  В режиме explain для каждого слова замеряется время и объём работы,
+ *  а после каждого слова - порог top-k.
+ *  Фраза в кавычках - одно "слово": её список вхождений (документы, где
+ *  фраза найдена, и число совпадений) строится заранее в MatchPhrase,
+ *  которая сама расходует срок и бюджет.
+ *  В режиме And вместо сложения списков они пересекаются (IntersectLists);
+ *  если какого-то слова нет в индексе, результат пуст без чтения списков.
  */
-std::vector<std::vector<RelativeIndex>> SearchServer::search(const std::vector<std::string> &queries_input)
+QueryResult SearchServer::Score(const std::string &query, const QueryOptions &options) const
 {
-    std::vector<std::vector<RelativeIndex>> all_results;
-    all_results.reserve(queries_input.size());
+    auto &doc_relevance = scratch.doc_relevance;
+    auto &touched = scratch.touched;
+    auto &lists = scratch.lists;
+    RelevanceRelease release;
+    touched.clear();
+    lists.clear();
 
-    for (auto &query : queries_input) {
-        std::unordered_map<size_t, size_t> doc_relevance;
-        // Разбиваем запрос на слова
-        std::istringstream iss(query);
-        std::string word;
-        while (iss >> word) {
-            // Находим, в каких документах встречается слово
-            auto entries = _index.GetWordCount(word);
-            for (auto &e : entries) {
-                doc_relevance[e.doc_id] += e.count; // size_t -> size_t (нет предупреждения C4267)
-            }
-        }
-        if (doc_relevance.empty()) {
-            // Если документов нет
-            all_results.push_back({});
-            continue;
+    QueryResult query_result;
+    QueryExplain *explain = nullptr;
+    if (options.explain) {
+        query_result.explain = std::make_shared<QueryExplain>();
+        explain = query_result.explain.get();
+    }
+
+    const bool has_deadline = options.deadline != std::chrono::steady_clock::time_point::max();
+    const size_t budget = options.max_postings > 0 ? options.max_postings : SIZE_MAX;
+    size_t scored = 0;
+
+    // Разбиваем запрос на слова и фразы и находим, в каких документах встречается каждое
+    bool missing = false;
+    auto add_list = [&lists, &missing, explain](PostingsView postings, std::string term, bool precomputed) {
+        size_t position = 0;
+        if (explain) {
+            position = explain->terms.size();
+            explain->terms.emplace_back();
+            explain->terms.back().term = std::move(term);
+            explain->terms.back().posting_length = postings.size;
         }
-        // Находим maximum
-        size_t max_abs = 0;
-        for (auto &kv : doc_relevance) {
-            if (kv.second > max_abs) {
-                max_abs = kv.second;
-            }
+        if (!postings.empty()) {
+            lists.push_back({postings, position, precomputed});
+        } else {
+            missing = true;
         }
-        // Вычисляем ранги
-        std::vector<RelativeIndex> result;
-        result.reserve(doc_relevance.size());
-        for (auto &kv : doc_relevance) {
-            float rank = static_cast<float>(kv.second) / static_cast<float>(max_abs);
-            result.push_back({kv.first, rank});
-        }
-        // Сортируем по убыванию rank, при равенстве - по doc_id
-        std::sort(result.begin(), result.end(), [](const RelativeIndex &a, const RelativeIndex &b){
-            if (std::fabs(a.rank - b.rank) < 1e-6) {
-                return a.doc_id < b.doc_id;
-            }
-            return a.rank > b.rank;
+    };
+    size_t phrase_count = 0;
+    ForEachQueryPart(query, [this, &add_list, explain](std::string_view word) {
+        std::string term(word);
+        add_list(_index.GetPostings(term), explain ? NormalizeWord(term) : std::string(), false);
+    }, [this, &add_list, &phrase_count, &options, &scored, &query_result, explain](std::string_view text, size_t slop) {
+        auto &words = scratch.phrase_words;
+        words.clear();
+        ForEachToken(text, [&words](std::string_view word) {
+            words.push_back(NormalizeWord(word));
         });
+        if (words.size() == 1) {
+            add_list(_index.GetPostings(words[0]), words[0], false);
+            return;
+        }
+        if (words.empty()) {
+            return;
+        }
+        if (scratch.phrases.size() == phrase_count) {
+            scratch.phrases.emplace_back();
+        }
+        // Буферы фраз не освобождаются между запросами; при росте вектора
+        // фраз сами массивы перемещаются без копирования и указатели в lists остаются верными
+        PhrasePostings &phrase = scratch.phrases[phrase_count++];
+        size_t position_bytes = 0;
+        if (!MatchPhrase(_index, words, slop, options, scored, position_bytes, phrase)) {
+            query_result.partial = true;
+        }
+        add_list(phrase.View(), explain ? PhraseKey(words, slop) : std::string(), true);
+        if (explain) {
+            explain->terms.back().position_bytes = position_bytes;
+        }
+    });
+    // Готовые списки фраз - первыми: они уже оплачены и попадут в выдачу,
+    // даже если на поиске фраз кончились срок или бюджет
+    std::stable_sort(lists.begin(), lists.end(), [](const TermList &a, const TermList &b) {
+        if (a.precomputed != b.precomputed) {
+            return a.precomputed;
+        }
+        return a.postings.size < b.postings.size;
+    });
 
-        // (Обрезание Top5 можно делать тут или в main.cpp)
+    // Массив релевантности - только на диапазон doc_id, где возможны кандидаты:
+    // от первого до последнего документа всех списков (в режиме And - общий
+    // для всех списков). Вне запроса массив целиком нулевой, поэтому сдвиг
+    // base не требует очистки
+    if (!lists.empty()) {
+        const bool intersect = options.mode == QueryMode::And;
+        uint32_t low = intersect ? 0 : UINT32_MAX;
+        uint32_t high = intersect ? UINT32_MAX : 0;
+        for (const auto &list : lists) {
+            uint32_t front = list.postings.doc_ids[0];
+            uint32_t back = list.postings.doc_ids[list.postings.size - 1];
+            low = intersect ? std::max(low, front) : std::min(low, front);
+            high = intersect ? std::min(high, back) : std::max(high, back);
+        }
+        scratch.base = low;
+        size_t range = low <= high ? static_cast<size_t>(high - low) + 1 : 0;
+        if (doc_relevance.size() < range) {
+            doc_relevance.resize(range, 0);
+        }
+    }
+
+    size_t processed = 0;
+    if (options.mode == QueryMode::And) {
+        if (!missing && !lists.empty()) {
+            scored += IntersectLists(lists, options, query_result, explain);
+            processed = lists.size();
+        }
+    } else {
+        for (auto &list : lists) {
+            processed++;
+            auto term_started = explain ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+            size_t term_scored = 0;
+            size_t blocks = 0;
+            size_t count_bytes = 0;
+            bool stopped = false;
+            list.postings.VisitCounts([&](const uint32_t *doc_ids, const auto *counts, size_t size) {
+                count_bytes = sizeof(counts[0]);
+                for (size_t begin = 0; begin < size;) {
+                    if (!list.precomputed && (scored >= budget ||
+                        (has_deadline && std::chrono::steady_clock::now() >= options.deadline))) {
+                        query_result.partial = true;
+                        stopped = true;
+                        break;
+                    }
+                    size_t end = begin + std::min({size - begin, kBlockSize,
+                                                   list.precomputed ? kBlockSize : budget - scored});
+                    for (size_t j = begin; j < end; j++) {
+                        uint32_t &abs = scratch.Relevance(doc_ids[j]);
+                        if (abs == 0) {
+                            touched.push_back(doc_ids[j]);
+                        }
+                        abs = AddSaturated(abs, counts[j]);
+                    }
+                    if (!list.precomputed) {
+                        scored += end - begin;
+                    }
+                    term_scored += end - begin;
+                    blocks++;
+                    begin = end;
+                }
+            });
+            if (explain) {
+                TermExplain &term = explain->terms[list.position];
+                term.postings_scored = term_scored;
+                term.bytes_decoded = term_scored * (sizeof(uint32_t) + count_bytes);
+                term.blocks_scanned = blocks;
+                term.blocks_skipped = (list.postings.size + kBlockSize - 1) / kBlockSize - blocks;
+                term.time = Since(term_started);
+                explain->thresholds.push_back({list.position, touched.size(),
+                                               TopKThreshold(options.limit)});
+            }
+            if (stopped) {
+                break;
+            }
+        }
+    }
+    if (explain) {
+        // Списки, до которых не дошли после досрочной остановки, пропущены целиком
+        for (size_t i = processed; i < lists.size(); i++) {
+            explain->terms[lists[i].position].blocks_skipped = (lists[i].postings.size + kBlockSize - 1) / kBlockSize;
+        }
+    }
+    query_result.postings_scored = scored;
+    if (touched.empty()) {
+        // Если документов нет
+        return query_result;
+    }
+    // Находим maximum
+    uint32_t max_abs = 0;
+    for (uint32_t doc_id : touched) {
+        max_abs = std::max(max_abs, scratch.Relevance(doc_id));
+    }
+    // Вычисляем ранги
+    std::vector<RelativeIndex> &result = query_result.items;
+    result.reserve(touched.size());
+    for (uint32_t doc_id : touched) {
+        uint32_t &abs = scratch.Relevance(doc_id);
+        float rank = static_cast<float>(abs) / static_cast<float>(max_abs);
+        result.push_back({doc_id, rank});
+        abs = 0;
+    }
+    // Сортируем по убыванию rank, при равенстве - по doc_id
+    std::sort(result.begin(), result.end(), [](const RelativeIndex &a, const RelativeIndex &b){
+        if (std::fabs(a.rank - b.rank) < 1e-6) {
+            return a.doc_id < b.doc_id;
+        }
+        return a.rank > b.rank;
+    });
 
-        all_results.push_back(result);
+    // Оставляем только TopN
+    if (result.size() > options.limit) {
+        result.resize(options.limit);
     }
-    return all_results;
+    return query_result;
 }
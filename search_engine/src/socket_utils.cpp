@@ -0,0 +1,230 @@
+#include "socket_utils.h"
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#endif
+
+SocketAddress SocketAddress::Parse(const std::string &text) {
+    SocketAddress address;
+    if (text.rfind("unix:", 0) == 0) {
+        address.unix_path = text.substr(5);
+        if (address.unix_path.empty()) {
+            throw std::runtime_error("empty unix socket path");
+        }
+        return address;
+    }
+    std::string port = text;
+    auto colon = text.rfind(':');
+    if (colon != std::string::npos) {
+        address.host = text.substr(0, colon);
+        port = text.substr(colon + 1);
+    }
+    try {
+        size_t used = 0;
+        int value = std::stoi(port, &used);
+        if (used != port.size() || value < 0 || value > 65535) {
+            throw std::invalid_argument(port);
+        }
+        address.port = static_cast<uint16_t>(value);
+    } catch (const std::logic_error &) {
+        throw std::runtime_error("invalid port in address: " + text);
+    }
+    return address;
+}
+
+bool SocketAddress::IsLoopback() const {
+    if (IsUnix() || host == "localhost") {
+        return true;
+    }
+    // Четыре десятичных октета, первый - 127
+    size_t octets = 0;
+    size_t pos = 0;
+    while (pos <= host.size()) {
+        size_t end = host.find('.', pos);
+        end = end == std::string::npos ? host.size() : end;
+        std::string octet = host.substr(pos, end - pos);
+        if (octet.empty() || octet.size() > 3 ||
+            octet.find_first_not_of("0123456789") != std::string::npos || std::stoi(octet) > 255) {
+            return false;
+        }
+        if (octets == 0 && octet != "127") {
+            return false;
+        }
+        octets++;
+        pos = end + 1;
+    }
+    return octets == 4;
+}
+
+#ifndef _WIN32
+
+namespace {
+
+std::runtime_error SystemError(const std::string &what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+sockaddr_un MakeUnixAddress(const std::string &path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("unix socket path is too long: " + path);
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+sockaddr_in MakeTcpAddress(const SocketAddress &address) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(address.port);
+    if (inet_pton(AF_INET, address.host.c_str(), &addr.sin_addr) != 1) {
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        addrinfo *result = nullptr;
+        if (getaddrinfo(address.host.c_str(), nullptr, &hints, &result) != 0 || !result) {
+            throw std::runtime_error("cannot resolve host " + address.host);
+        }
+        addr.sin_addr = reinterpret_cast<sockaddr_in *>(result->ai_addr)->sin_addr;
+        freeaddrinfo(result);
+    }
+    return addr;
+}
+
+} // namespace
+
+int ListenSocket(const SocketAddress &address, int backlog) {
+    int fd;
+    if (address.IsUnix()) {
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw SystemError("socket");
+        }
+        // Старый файл сокета заменяем, а любой другой файл по этому пути - нет
+        struct stat info {};
+        if (::lstat(address.unix_path.c_str(), &info) == 0) {
+            if (!S_ISSOCK(info.st_mode)) {
+                ::close(fd);
+                throw std::runtime_error(address.unix_path + " exists and is not a socket");
+            }
+            ::unlink(address.unix_path.c_str());
+        }
+        sockaddr_un addr = MakeUnixAddress(address.unix_path);
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+            ::close(fd);
+            throw SystemError("bind " + address.unix_path);
+        }
+    } else {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw SystemError("socket");
+        }
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr = MakeTcpAddress(address);
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+            ::close(fd);
+            throw SystemError("bind " + address.host + ":" + std::to_string(address.port));
+        }
+    }
+    if (::listen(fd, backlog) < 0) {
+        ::close(fd);
+        throw SystemError("listen");
+    }
+    return fd;
+}
+
+int ConnectSocket(const SocketAddress &address) {
+    int fd;
+    int result;
+    if (address.IsUnix()) {
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw SystemError("socket");
+        }
+        sockaddr_un addr = MakeUnixAddress(address.unix_path);
+        result = ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    } else {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw SystemError("socket");
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        sockaddr_in addr = MakeTcpAddress(address);
+        result = ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    }
+    if (result < 0) {
+        ::close(fd);
+        throw SystemError("connect");
+    }
+    return fd;
+}
+
+uint16_t LocalPort(int fd) {
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    if (::getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) < 0 || addr.sin_family != AF_INET) {
+        return 0;
+    }
+    return ntohs(addr.sin_port);
+}
+
+bool WriteAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+    return true;
+}
+
+void CloseSocket(int fd) {
+    ::close(fd);
+}
+
+void RemoveUnixSocket(const std::string &path) {
+    struct stat info {};
+    if (::lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+        ::unlink(path.c_str());
+    }
+}
+
+void ShutdownSocket(int fd) {
+    ::shutdown(fd, SHUT_RDWR);
+}
+
+#else
+
+namespace {
+
+[[noreturn]] void Unsupported() {
+    throw std::runtime_error("sockets are not supported on this platform");
+}
+
+} // namespace
+
+int ListenSocket(const SocketAddress &, int) { Unsupported(); }
+int ConnectSocket(const SocketAddress &) { Unsupported(); }
+uint16_t LocalPort(int) { Unsupported(); }
+bool WriteAll(int, std::string_view) { Unsupported(); }
+void CloseSocket(int) {}
+void RemoveUnixSocket(const std::string &) {}
+void ShutdownSocket(int) {}
+
+#endif
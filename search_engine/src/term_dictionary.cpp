@@ -0,0 +1,138 @@
+#include "term_dictionary.h"
+#include <algorithm>
+#include <stdexcept>
+
+StringArena::StringArena(size_t block_size)
+    : _block_size(block_size)
+{}
+
+std::string_view StringArena::Store(std::string_view s) {
+    if (s.empty()) {
+        return {};
+    }
+    if (_block_pos + s.size() > _block_capacity) {
+        // Слишком длинные строки получают отдельный блок
+        size_t capacity = std::max(_block_size, s.size());
+        _blocks.emplace_back(new char[capacity]);
+        _block_pos = 0;
+        _block_capacity = capacity;
+        _bytes_reserved += capacity;
+    }
+    char *dst = _blocks.back().get() + _block_pos;
+    std::memcpy(dst, s.data(), s.size());
+    _block_pos += s.size();
+    _bytes_used += s.size();
+    return {dst, s.size()};
+}
+
+void StringArena::Clear() {
+    _blocks.clear();
+    _block_pos = 0;
+    _block_capacity = 0;
+    _bytes_used = 0;
+    _bytes_reserved = 0;
+}
+
+uint32_t TermDictionary::Intern(std::string_view term, uint64_t hash) {
+    // Держим заполненность таблицы не выше 1/2
+    if ((_terms.size() + 1) * 2 > _slots.size()) {
+        Grow();
+    }
+    size_t mask = _slots.size() - 1;
+    for (size_t pos = hash & mask;; pos = (pos + 1) & mask) {
+        Slot &slot = _slots[pos];
+        if (slot.id == kNoTerm) {
+            if (_terms.size() >= kNoTerm) {
+                throw std::runtime_error("too many distinct terms");
+            }
+            slot.hash = hash;
+            slot.id = static_cast<uint32_t>(_terms.size());
+            _terms.push_back(_arena.Store(term));
+            return slot.id;
+        }
+        if (slot.hash == hash && _terms[slot.id] == term) {
+            return slot.id;
+        }
+    }
+}
+
+uint32_t TermDictionary::Find(std::string_view term, uint64_t hash) const {
+    if (_slots.empty()) {
+        return kNoTerm;
+    }
+    size_t mask = _slots.size() - 1;
+    for (size_t pos = hash & mask;; pos = (pos + 1) & mask) {
+        const Slot &slot = _slots[pos];
+        if (slot.id == kNoTerm) {
+            return kNoTerm;
+        }
+        if (slot.hash == hash && _terms[slot.id] == term) {
+            return slot.id;
+        }
+    }
+}
+
+void TermDictionary::Clear() {
+    _arena.Clear();
+    _terms.clear();
+    _slots.clear();
+}
+
+void TermDictionary::Grow() {
+    size_t new_size = _slots.empty() ? 64 : _slots.size() * 2;
+    std::vector<Slot> slots(new_size, Slot{0, kNoTerm});
+    size_t mask = new_size - 1;
+    for (const Slot &slot : _slots) {
+        if (slot.id == kNoTerm) {
+            continue;
+        }
+        size_t pos = slot.hash & mask;
+        while (slots[pos].id != kNoTerm) {
+            pos = (pos + 1) & mask;
+        }
+        slots[pos] = slot;
+    }
+    _slots.swap(slots);
+}
+
+TermCounter::TermCounter(std::pmr::memory_resource *resource)
+    : _items(resource), _slots(resource)
+{}
+
+uint32_t TermCounter::Add(std::string_view term, uint64_t hash) {
+    if ((_items.size() + 1) * 2 > _slots.size()) {
+        Grow();
+    }
+    size_t mask = _slots.size() - 1;
+    for (size_t pos = hash & mask;; pos = (pos + 1) & mask) {
+        uint32_t ref = _slots[pos];
+        if (ref == 0) {
+            _items.push_back({term, hash, 1});
+            _slots[pos] = static_cast<uint32_t>(_items.size());
+            return static_cast<uint32_t>(_items.size() - 1);
+        }
+        Item &item = _items[ref - 1];
+        if (item.hash == hash && item.term == term) {
+            item.count++;
+            return ref - 1;
+        }
+    }
+}
+
+void TermCounter::Clear() {
+    _items.clear();
+    std::fill(_slots.begin(), _slots.end(), 0);
+}
+
+void TermCounter::Grow() {
+    size_t new_size = _slots.empty() ? 64 : _slots.size() * 2;
+    _slots.assign(new_size, 0);
+    size_t mask = new_size - 1;
+    for (size_t i = 0; i < _items.size(); i++) {
+        size_t pos = _items[i].hash & mask;
+        while (_slots[pos] != 0) {
+            pos = (pos + 1) & mask;
+        }
+        _slots[pos] = static_cast<uint32_t>(i + 1);
+    }
+}
@@ -0,0 +1,252 @@
+#include "text_normalizer.h"
+#include <array>
+#include <cstdint>
+
+namespace {
+
+// Таблица для ASCII: заглавные латинские буквы -> строчные, остальное без изменений
+constexpr std::array<unsigned char, 128> MakeAsciiTable() {
+    std::array<unsigned char, 128> table{};
+    for (int c = 0; c < 128; c++) {
+        table[c] = static_cast<unsigned char>((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c);
+    }
+    return table;
+}
+
+constexpr std::array<unsigned char, 128> kAsciiLower = MakeAsciiTable();
+
+/**
+ * Таблица для кириллицы с ведущим байтом 0xD0 (U+0400..U+043F):
+ * по второму байту (0x80..0xBF) хранит пару байтов строчной буквы.
+ */
+struct Utf8Pair {
+    unsigned char lead;
+    unsigned char tail;
+};
+
+constexpr std::array<Utf8Pair, 64> MakeCyrillicTable() {
+    std::array<Utf8Pair, 64> table{};
+    for (int i = 0; i < 64; i++) {
+        int tail = 0x80 + i;
+        if (tail <= 0x8F) {
+            // Ѐ..Џ (U+0400..U+040F) -> ѐ..џ (U+0450..U+045F)
+            table[i] = {0xD1, static_cast<unsigned char>(tail + 0x10)};
+        } else if (tail <= 0x9F) {
+            // А..П (U+0410..U+041F) -> а..п (U+0430..U+043F)
+            table[i] = {0xD0, static_cast<unsigned char>(tail + 0x20)};
+        } else if (tail <= 0xAF) {
+            // Р..Я (U+0420..U+042F) -> р..я (U+0440..U+044F)
+            table[i] = {0xD1, static_cast<unsigned char>(tail - 0x20)};
+        } else {
+            // а..п уже строчные
+            table[i] = {0xD0, static_cast<unsigned char>(tail)};
+        }
+    }
+    return table;
+}
+
+constexpr std::array<Utf8Pair, 64> kCyrillicLower = MakeCyrillicTable();
+
+bool IsContinuation(unsigned char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+/**
+ * Простое (однозначное) приведение кодовой точки к нижнему регистру
+ * для алфавитов вне быстрого пути.
+ */
+char32_t FoldCodePoint(char32_t cp) {
+    if (cp < 0x80) {
+        return kAsciiLower[cp];
+    }
+    // Latin-1 Supplement
+    if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) {
+        return cp + 0x20;
+    }
+    // Latin Extended-A
+    if (cp == 0x130) {
+        return 'i';
+    }
+    if (cp == 0x178) {
+        return 0xFF;
+    }
+    if ((cp >= 0x100 && cp <= 0x137) || (cp >= 0x14A && cp <= 0x177)) {
+        return (cp % 2 == 0) ? cp + 1 : cp;
+    }
+    if ((cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E)) {
+        return (cp % 2 == 1) ? cp + 1 : cp;
+    }
+    // Греческий
+    if (cp == 0x386) {
+        return 0x3AC;
+    }
+    if (cp >= 0x388 && cp <= 0x38A) {
+        return cp + 0x25;
+    }
+    if (cp == 0x38C) {
+        return 0x3CC;
+    }
+    if (cp == 0x38E || cp == 0x38F) {
+        return cp + 0x3F;
+    }
+    if (cp >= 0x391 && cp <= 0x3AB && cp != 0x3A2) {
+        return cp + 0x20;
+    }
+    // Кириллица (основной блок на случай вызова вне быстрого пути)
+    if (cp >= 0x400 && cp <= 0x40F) {
+        return cp + 0x50;
+    }
+    if (cp >= 0x410 && cp <= 0x42F) {
+        return cp + 0x20;
+    }
+    // Расширенная кириллица
+    if (cp == 0x4C0) {
+        return 0x4CF;
+    }
+    if ((cp >= 0x460 && cp <= 0x481) || (cp >= 0x48A && cp <= 0x4BF) ||
+        (cp >= 0x4D0 && cp <= 0x52F)) {
+        return (cp % 2 == 0) ? cp + 1 : cp;
+    }
+    if (cp >= 0x4C1 && cp <= 0x4CE) {
+        return (cp % 2 == 1) ? cp + 1 : cp;
+    }
+    // Армянский
+    if (cp >= 0x531 && cp <= 0x556) {
+        return cp + 0x30;
+    }
+    // Грузинский (Асомтаврули -> Нусхури)
+    if ((cp >= 0x10A0 && cp <= 0x10C5) || cp == 0x10C7 || cp == 0x10CD) {
+        return cp + 0x1C60;
+    }
+    // Latin Extended Additional
+    if ((cp >= 0x1E00 && cp <= 0x1E95) || (cp >= 0x1EA0 && cp <= 0x1EFF)) {
+        return (cp % 2 == 0) ? cp + 1 : cp;
+    }
+    // Глаголица
+    if (cp >= 0x2C00 && cp <= 0x2C2F) {
+        return cp + 0x30;
+    }
+    // Полноширинная латиница
+    if (cp >= 0xFF21 && cp <= 0xFF3A) {
+        return cp + 0x20;
+    }
+    return cp;
+}
+
+template <typename String>
+void AppendUtf8(char32_t cp, String &out) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+/**
+ * Декодирует одну многобайтовую последовательность, начиная с позиции i.
+ * Возвращает её длину или 0, если последовательность некорректна.
+ */
+size_t DecodeUtf8(std::string_view s, size_t i, char32_t &cp) {
+    auto lead = static_cast<unsigned char>(s[i]);
+    size_t len;
+    char32_t min_value;
+    if ((lead & 0xE0) == 0xC0) {
+        len = 2; cp = lead & 0x1F; min_value = 0x80;
+    } else if ((lead & 0xF0) == 0xE0) {
+        len = 3; cp = lead & 0x0F; min_value = 0x800;
+    } else if ((lead & 0xF8) == 0xF0) {
+        len = 4; cp = lead & 0x07; min_value = 0x10000;
+    } else {
+        return 0;
+    }
+    if (i + len > s.size()) {
+        return 0;
+    }
+    for (size_t k = 1; k < len; k++) {
+        auto c = static_cast<unsigned char>(s[i + k]);
+        if (!IsContinuation(c)) {
+            return 0;
+        }
+        cp = (cp << 6) | (c & 0x3F);
+    }
+    if (cp < min_value || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        return 0;
+    }
+    return len;
+}
+
+template <typename String>
+void NormalizeInto(std::string_view word, String &out) {
+    out.clear();
+    out.reserve(word.size());
+    size_t i = 0;
+    while (i < word.size()) {
+        auto c = static_cast<unsigned char>(word[i]);
+        // Быстрый путь: ASCII
+        if (c < 0x80) {
+            out.push_back(static_cast<char>(kAsciiLower[c]));
+            i++;
+            continue;
+        }
+        // Быстрый путь: кириллица U+0400..U+043F
+        if (c == 0xD0 && i + 1 < word.size() &&
+            IsContinuation(static_cast<unsigned char>(word[i + 1]))) {
+            const Utf8Pair &p = kCyrillicLower[static_cast<unsigned char>(word[i + 1]) - 0x80];
+            out.push_back(static_cast<char>(p.lead));
+            out.push_back(static_cast<char>(p.tail));
+            i += 2;
+            continue;
+        }
+        // Строчная кириллица U+0440..U+047F не меняется
+        if (c == 0xD1 && i + 1 < word.size() &&
+            IsContinuation(static_cast<unsigned char>(word[i + 1]))) {
+            auto tail = static_cast<unsigned char>(word[i + 1]);
+            if (tail >= 0xA0) {
+                // U+0460..U+047F: исторические буквы в парах заглавная/строчная
+                char32_t cp = 0x440 + (tail - 0x80);
+                AppendUtf8(FoldCodePoint(cp), out);
+            } else {
+                out.push_back(static_cast<char>(c));
+                out.push_back(static_cast<char>(tail));
+            }
+            i += 2;
+            continue;
+        }
+        // Общий случай: декодируем кодовую точку
+        char32_t cp = 0;
+        size_t len = DecodeUtf8(word, i, cp);
+        if (len == 0) {
+            out.push_back(static_cast<char>(c));
+            i++;
+            continue;
+        }
+        AppendUtf8(FoldCodePoint(cp), out);
+        i += len;
+    }
+}
+
+} // namespace
+
+void NormalizeWord(std::string_view word, std::string &out) {
+    NormalizeInto(word, out);
+}
+
+void NormalizeWord(std::string_view word, std::pmr::string &out) {
+    NormalizeInto(word, out);
+}
+
+std::string NormalizeWord(std::string_view word) {
+    std::string res;
+    NormalizeWord(word, res);
+    return res;
+}
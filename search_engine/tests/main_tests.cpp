@@ -1,7 +1,33 @@
 #include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+#include <future>
+#include <mutex>
+#include <random>
+#ifndef _WIN32
+#include <sys/socket.h>
+#endif
 #include "converter_json.h"
 #include "inverted_index.h"
 #include "search_server.h"
+#include "search_pipeline.h"
+#include "text_normalizer.h"
+#include "term_dictionary.h"
+#include "answers_writer.h"
+#include "answers_reader.h"
+#include "query_server.h"
+#include "http_server.h"
+#include "query_scheduler.h"
+#include "corpus_generator.h"
+#include "latency_histogram.h"
+#include "load_generator.h"
+#include "metrics.h"
+#include "explain_json.h"
+#include "document_store.h"
+#include <nlohmann/json.hpp>
 
 /**
  * Тесты InvertedIndex
@@ -63,6 +89,207 @@ TEST(TestCaseInvertedIndex, TestInvertedIndexMissingWord) {
     TestInvertedIndexFunctionality(docs, reqs, expected);
 }
 
+TEST(TestCaseInvertedIndex, TestCyrillicCaseFolding) {
+    const std::vector<std::string> docs = {
+        "Москва столица России",
+        "МОСКВА москва Ёлка ёлка"
+    };
+    const std::vector<std::string> reqs = {"москва", "МоСкВа", "ёлка", "россии"};
+    const std::vector<std::vector<Entry>> expected = {
+        { {0,1},{1,2} },
+        { {0,1},{1,2} },
+        { {1,2} },
+        { {0,1} }
+    };
+    TestInvertedIndexFunctionality(docs, reqs, expected);
+}
+
+TEST(TestCaseNormalizer, TestOtherScripts) {
+    ASSERT_EQ(NormalizeWord("London"), "london");
+    ASSERT_EQ(NormalizeWord("ΑΘΗΝΑ"), "αθηνα");
+    ASSERT_EQ(NormalizeWord("ÉCOLE"), "école");
+    ASSERT_EQ(NormalizeWord("ŁÓDŹ"), "łódź");
+    // Некорректный UTF-8 не должен теряться
+    ASSERT_EQ(NormalizeWord("A\xFF\xD0"), "a\xFF\xD0");
+}
+
+TEST(TestCaseTermDictionary, TestDenseIds) {
+    TermDictionary dict;
+    std::vector<std::string> words;
+    for (int i = 0; i < 1000; i++) {
+        words.push_back("term" + std::to_string(i));
+    }
+    for (size_t i = 0; i < words.size(); i++) {
+        ASSERT_EQ(dict.Intern(words[i]), i);
+    }
+    // Повторное добавление возвращает тот же идентификатор
+    ASSERT_EQ(dict.Intern("term500"), 500u);
+    ASSERT_EQ(dict.Size(), words.size());
+    ASSERT_EQ(dict.Find("term999"), 999u);
+    ASSERT_EQ(dict.Term(42), "term42");
+    ASSERT_EQ(dict.Find("missing"), TermDictionary::kNoTerm);
+}
+
+TEST(TestCaseInvertedIndex, TestScratchMemoryStats) {
+    std::vector<std::string> docs;
+    for (int i = 0; i < 50; i++) {
+        docs.push_back("milk water sugar coffee tea " + std::to_string(i));
+    }
+    IndexOptions options;
+    options.threads = 2;
+    InvertedIndex idx(options);
+    idx.UpdateDocumentBase(docs);
+    const auto &stats = idx.GetIndexingMemoryStats();
+    ASSERT_EQ(stats.documents, docs.size());
+    ASSERT_GT(stats.scratch.allocations, 0u);
+    ASSERT_GT(stats.peak_document_bytes, 0u);
+    // Небольшие документы целиком помещаются в начальный буфер арены:
+    // к malloc обращается только пул при создании (по разу на поток)
+    ASSERT_LE(stats.heap.allocations, options.threads);
+    ASSERT_EQ(idx.GetWordCount("milk").size(), docs.size());
+}
+
+TEST(TestCaseInvertedIndex, TestMemoryReport) {
+    std::string long_doc(100, 'x');
+    std::vector<std::string> docs = {"milk water", "milk " + long_doc, "milk"};
+    IndexOptions options;
+    options.threads = 1;
+    options.count_width = CountWidth::Bits16;
+    // По умолчанию тексты не сохраняются
+    InvertedIndex plain(options);
+    plain.UpdateDocumentBase(docs);
+    ASSERT_EQ(plain.GetMemoryReport().stored_documents, 0u);
+    ASSERT_EQ(plain.GetMemoryReport().stored_headers, 0u);
+    ASSERT_THROW(plain.GetDocument(1), std::logic_error);
+
+    options.keep_documents = true;
+    InvertedIndex idx(options);
+    idx.UpdateDocumentBase(docs);
+    ASSERT_EQ(idx.GetDocument(1), docs[1]);
+    IndexMemoryReport report = idx.GetMemoryReport(2);
+    // milk, water, xxx...x
+    ASSERT_EQ(report.dictionary_keys, 4u + 5u + 100u);
+    // 5 вхождений по 4 байта doc_id и 2 байта счётчика
+    ASSERT_EQ(report.posting_payload, 5u * 6u);
+    // В куче лежит только длинный документ, короткие - внутри std::string
+    ASSERT_EQ(report.stored_documents, docs[1].size());
+    ASSERT_GE(report.stored_headers, 3 * sizeof(std::string));
+    ASSERT_GT(report.dictionary_table, 0u);
+    ASSERT_EQ(report.Total(), report.dictionary_keys + report.dictionary_table + report.posting_payload +
+                              report.posting_headers + report.position_payload + report.position_headers +
+                              report.stored_documents + report.stored_headers +
+                              report.allocator_overhead);
+    ASSERT_EQ(report.largest_terms.size(), 2u);
+    ASSERT_EQ(report.largest_terms[0].term, "milk");
+    ASSERT_EQ(report.largest_terms[0].postings, 3u);
+    ASSERT_EQ(report.largest_terms[0].bytes, 18u);
+    ASSERT_EQ(report.largest_terms[1].term, "water");
+
+    // Короткие записи позиций лежат внутри PositionList: в куче только таблицы пропусков
+    IndexOptions position_options;
+    position_options.threads = 1;
+    position_options.positions = true;
+    InvertedIndex positional(position_options);
+    positional.UpdateDocumentBase({"milk water", "milk"});
+    IndexMemoryReport position_report = positional.GetMemoryReport();
+    ASSERT_EQ(position_report.position_payload, 2 * sizeof(uint64_t));
+    ASSERT_GE(position_report.position_headers, 2 * sizeof(PositionList));
+}
+
+TEST(TestCaseInvertedIndex, TestCompactCounts) {
+    std::string big;
+    for (int i = 0; i < 70000; i++) {
+        big += "milk ";
+    }
+    const std::vector<std::string> docs = {big, "milk water"};
+    IndexOptions options;
+    options.count_width = CountWidth::Bits16;
+    InvertedIndex idx(options);
+    idx.UpdateDocumentBase(docs);
+    // 16-битный счётчик насыщается, а не переполняется
+    const std::vector<Entry> expected = { {0, 65535}, {1, 1} };
+    ASSERT_EQ(idx.GetWordCount("milk"), expected);
+
+    PostingsView view = idx.GetPostings("MILK");
+    ASSERT_EQ(view.size, 2u);
+    ASSERT_NE(view.counts16, nullptr);
+    ASSERT_EQ(view.doc_ids[1], 1u);
+}
+
+TEST(TestCaseInvertedIndex, TestPostingsOrderedAcrossThreads) {
+    std::vector<std::string> docs;
+    for (int i = 0; i < 200; i++) {
+        // Документы разной длины, чтобы диапазоны потоков были неравными
+        docs.push_back(std::string(static_cast<size_t>(i % 7) * 10, ' ') + "common word" + std::to_string(i % 3));
+    }
+    IndexOptions options;
+    options.threads = 4;
+    InvertedIndex idx(options);
+    idx.UpdateDocumentBase(docs);
+    auto entries = idx.GetWordCount("common");
+    ASSERT_EQ(entries.size(), docs.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        ASSERT_EQ(entries[i].doc_id, i);
+    }
+    ASSERT_EQ(idx.GetWordCount("word1").size(), 67u);
+}
+
+TEST(TestCaseInvertedIndex, TestExternalBuildMatchesInMemory) {
+    std::vector<std::string> docs;
+    for (int i = 0; i < 60; i++) {
+        std::string doc;
+        for (int j = 0; j <= i % 9; j++) {
+            doc += "word" + std::to_string((i * 7 + j) % 23) + " Общее ";
+        }
+        docs.push_back(doc);
+    }
+    auto dir = std::filesystem::temp_directory_path() / "search_engine_external_test";
+    std::filesystem::create_directories(dir);
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < docs.size(); i++) {
+        auto path = (dir / ("doc" + std::to_string(i) + ".txt")).string();
+        std::ofstream(path, std::ios::binary) << docs[i];
+        paths.push_back(path);
+    }
+
+    InvertedIndex expected_idx;
+    expected_idx.UpdateDocumentBase(docs);
+
+    IndexOptions options;
+    options.threads = 3;
+    options.memory_budget = 2048; // заведомо мало: части сбрасываются на диск
+    options.temp_dir = dir.string();
+    InvertedIndex idx(options);
+    idx.UpdateDocumentBaseFromFiles(paths);
+    ASSERT_GT(idx.GetIndexingMemoryStats().spilled_runs, 0u);
+    ASSERT_EQ(idx.GetDocumentCount(), docs.size());
+
+    for (int w = 0; w < 23; w++) {
+        auto word = "word" + std::to_string(w);
+        ASSERT_EQ(idx.GetWordCount(word), expected_idx.GetWordCount(word));
+    }
+    ASSERT_EQ(idx.GetWordCount("общее"), expected_idx.GetWordCount("общее"));
+    // Итоговые списки лежат в отображённом файле, а не в куче
+    IndexMemoryReport report = idx.GetMemoryReport();
+    ASSERT_EQ(report.posting_payload, 0u);
+    ASSERT_EQ(report.posting_mapped, expected_idx.GetMemoryReport().posting_payload);
+    // Части и файл списков удалены с диска: остались только документы
+    size_t files = 0;
+    for (auto &entry : std::filesystem::directory_iterator(dir)) {
+        static_cast<void>(entry);
+        files++;
+    }
+    ASSERT_EQ(files, docs.size());
+
+    // 16-битные счётчики в отображённом файле
+    options.count_width = CountWidth::Bits16;
+    InvertedIndex idx16(options);
+    idx16.UpdateDocumentBaseFromFiles(paths);
+    ASSERT_EQ(idx16.GetWordCount("общее"), expected_idx.GetWordCount("общее"));
+    ASSERT_NE(idx16.GetPostings("общее").counts16, nullptr);
+    std::filesystem::remove_all(dir);
+}
+
 /**
  * Тесты SearchServer
  */
@@ -146,6 +373,978 @@ TEST(TestCaseSearchServer, TestTop5) {
     ASSERT_EQ(conv, expected);
 }
 
+TEST(TestCaseSearchPipeline, TestMatchesBatchSearch) {
+    std::vector<std::string> docs;
+    for (int i = 0; i < 40; i++) {
+        docs.push_back("milk water " + std::string(static_cast<size_t>(i % 5), 'x') + " sugar" + std::to_string(i % 4));
+    }
+    std::vector<std::string> queries;
+    for (int i = 0; i < 500; i++) {
+        queries.push_back("milk sugar" + std::to_string(i % 6) + " xx");
+    }
+    InvertedIndex idx;
+    idx.UpdateDocumentBase(docs);
+    SearchServer srv(idx);
+    auto expected = srv.search(queries);
+
+    PipelineOptions options;
+    options.search_threads = 3;
+    options.queue_capacity = 4; // маленькие очереди: проверяем обратное давление
+    SearchPipeline pipeline(srv, options);
+    std::vector<std::vector<RelativeIndex>> results;
+    size_t count = pipeline.Run(
+        [&queries](const std::function<void(std::string &&)> &on_request) {
+            for (auto query : queries) {
+                on_request(std::move(query));
+            }
+        },
+        [&results](size_t index, std::vector<RelativeIndex> &&answer) {
+            ASSERT_EQ(index, results.size());
+            results.push_back(std::move(answer));
+        });
+    ASSERT_EQ(count, queries.size());
+    ASSERT_EQ(results, expected);
+}
+
+TEST(TestCaseSearchPipeline, TestSourceErrorPropagates) {
+    InvertedIndex idx;
+    idx.UpdateDocumentBase({"milk"});
+    SearchServer srv(idx);
+    SearchPipeline pipeline(srv);
+    auto source = [](const std::function<void(std::string &&)> &on_request) {
+        on_request("milk");
+        throw std::runtime_error("broken requests");
+    };
+    ASSERT_THROW(pipeline.Run(source, [](size_t, std::vector<RelativeIndex> &&) {}), std::runtime_error);
+}
+
+/**
+ * Тесты чтения requests.json
+ */
+
+TEST(TestCaseConverterJSON, TestStreamRequests) {
+    std::istringstream in(R"({"note": {"requests": ["skip"]}, "requests": ["milk water", "сахар"], "x": [1]})");
+    ConverterJSON converter;
+    std::vector<std::string> requests;
+    converter.StreamRequests(in, [&requests](std::string &&request) {
+        requests.push_back(std::move(request));
+    });
+    const std::vector<std::string> expected = {"milk water", "сахар"};
+    ASSERT_EQ(requests, expected);
+}
+
+TEST(TestCaseConverterJSON, TestStreamRequestsErrors) {
+    ConverterJSON converter;
+    auto ignore = [](std::string &&) {};
+    std::istringstream missing(R"({"other": []})");
+    ASSERT_THROW(converter.StreamRequests(missing, ignore), std::runtime_error);
+    std::istringstream not_string(R"({"requests": ["a", 1]})");
+    ASSERT_THROW(converter.StreamRequests(not_string, ignore), std::runtime_error);
+    std::istringstream object(R"({"requests": [{"q": "x"}]})");
+    ASSERT_THROW(converter.StreamRequests(object, ignore), std::runtime_error);
+    std::istringstream broken(R"({"requests": ["a")");
+    ASSERT_THROW(converter.StreamRequests(broken, ignore), std::runtime_error);
+}
+
+/**
+ * Тесты Config
+ */
+
+static std::string WriteTempConfig(const std::string &text) {
+    auto path = (std::filesystem::temp_directory_path() / "search_engine_config_test.json").string();
+    std::ofstream(path, std::ios::binary) << text;
+    return path;
+}
+
+TEST(TestCaseConfig, TestLoadTuningKnobs) {
+    auto path = WriteTempConfig(R"({
+        "config": {"name": "Test", "version": "0.1", "max_responses": 3,
+                   "threads": 4, "memory_budget_mb": 64, "posting_count_bits": 16,
+                   "answers_format": "compact",
+                   "document_store": "docs.seds", "document_codec": "none", "document_block_kb": 16},
+        "files": ["a.txt", "b.txt"]
+    })");
+    Config config = Config::Load(path);
+    ASSERT_EQ(config.name, "Test");
+    ASSERT_EQ(config.max_responses, 3);
+    ASSERT_EQ(config.files.size(), 2u);
+    ASSERT_EQ(config.threads, 4u);
+    ASSERT_EQ(config.memory_budget_mb, 64u);
+    ASSERT_EQ(config.count_width, CountWidth::Bits16);
+    ASSERT_EQ(config.answers_format, AnswersFormat::JsonCompact);
+    ASSERT_EQ(config.document_store, "docs.seds");
+    ASSERT_EQ(config.document_codec, DocumentCodec::None);
+    ASSERT_EQ(config.document_block_kb, 16u);
+
+    // Converter использует переданный Config и не читает файл повторно
+    ConverterJSON converter(config);
+    ASSERT_EQ(converter.GetResponsesLimit(), 3);
+    std::filesystem::remove(path);
+}
+
+TEST(TestCaseConfig, TestValidation) {
+    auto path = WriteTempConfig(R"({"config": {"name": "Test", "version": "0.2", "max_responses": 5}, "files": []})");
+    ASSERT_THROW(Config::Load(path), std::runtime_error);
+    path = WriteTempConfig(R"({"config": {"name": "Test", "version": "0.1", "max_responses": 5}})");
+    ASSERT_THROW(Config::Load(path), std::runtime_error);
+    path = WriteTempConfig(R"({"config": {"name": "Test", "version": "0.1", "max_responses": 5, "posting_count_bits": 8}, "files": []})");
+    ASSERT_THROW(Config::Load(path), std::runtime_error);
+    path = WriteTempConfig(R"({"config": {"name": "Test", "version": "0.1", "max_responses": 5, "threads": -1}, "files": []})");
+    ASSERT_THROW(Config::Load(path), std::runtime_error);
+    path = WriteTempConfig(R"({"config": {"name": "Test", "version": "0.1", "max_responses": 5, "positions": true,
+                                          "memory_budget_mb": 64}, "files": []})");
+    ASSERT_THROW(Config::Load(path), std::runtime_error);
+    path = WriteTempConfig(R"({"config": {"name": "Test", "version": "0.1", "max_responses": 5, "positions": 1}, "files": []})");
+    ASSERT_TRUE(Config::Load(path).positions);
+    path = WriteTempConfig(R"({"config": {"name": "Test", "version": "0.1", "max_responses": 5,
+                                          "memory_budget_mb": 18446744073709551615}, "files": []})");
+    ASSERT_THROW(Config::Load(path), std::runtime_error);
+    path = WriteTempConfig(R"({"config": {"name": "Test", "version": "0.1", "max_responses": 5, "query_mode": "and"}, "files": []})");
+    ASSERT_EQ(Config::Load(path).query_mode, QueryMode::And);
+    path = WriteTempConfig(R"({"config": {"name": "Test", "version": "0.1", "max_responses": 5, "query_mode": "any"}, "files": []})");
+    ASSERT_THROW(Config::Load(path), std::runtime_error);
+    std::filesystem::remove(path);
+    ASSERT_THROW(Config::Load(path), std::runtime_error);
+}
+
+/**
+ * Тесты записи answers.json
+ */
+
+static std::string ReadFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+TEST(TestCaseAnswersWriter, TestMatchesJsonDom) {
+    std::vector<std::vector<std::pair<int, float>>> answers = {
+        { {2, 1.0f}, {0, 0.7f}, {1, 0.3f} },
+        {},
+        { {7, 1.0f}, {14, 0.6666667f} }
+    };
+    // Эталон - прежняя запись через DOM nlohmann::json
+    nlohmann::json dom;
+    dom["answers"] = nlohmann::json::object();
+    for (size_t i = 0; i < answers.size(); i++) {
+        auto id = AnswersJsonWriter::RequestId(i);
+        if (answers[i].empty()) {
+            dom["answers"][id] = {{"result", "false"}};
+            continue;
+        }
+        nlohmann::json relevance = nlohmann::json::array();
+        for (auto &p : answers[i]) {
+            relevance.push_back({{"docid", p.first}, {"rank", p.second}});
+        }
+        dom["answers"][id] = {{"result", "true"}, {"relevance", relevance}};
+    }
+
+    auto path = (std::filesystem::temp_directory_path() / "search_engine_answers_test.json").string();
+    for (bool pretty : {true, false}) {
+        {
+            AnswersJsonWriter writer(path, pretty);
+            for (auto &answer : answers) {
+                writer.Write(answer);
+            }
+            writer.Finish();
+        }
+        ASSERT_EQ(ReadFile(path), pretty ? dom.dump(4) : dom.dump());
+    }
+    // Ранги читаются обратно без потерь
+    auto parsed = nlohmann::json::parse(ReadFile(path));
+    ASSERT_EQ(parsed["answers"]["request003"]["relevance"][1]["rank"].get<float>(), 0.6666667f);
+    {
+        AnswersJsonWriter writer(path);
+        writer.Finish();
+    }
+    ASSERT_EQ(ReadFile(path), nlohmann::json({{"answers", nlohmann::json::object()}}).dump(4));
+    // Прогон, прерванный ошибкой до Finish, не затирает прежние ответы
+    {
+        AnswersJsonWriter writer(path);
+        writer.Write(answers[0]);
+    }
+    ASSERT_EQ(ReadFile(path), nlohmann::json({{"answers", nlohmann::json::object()}}).dump(4));
+    ASSERT_FALSE(std::filesystem::exists(path + ".tmp"));
+    std::filesystem::remove(path);
+}
+
+TEST(TestCaseSearchServer, TestCandidateRange) {
+    // Кандидаты в середине и в конце базы: релевантность хранится только для их диапазона doc_id
+    std::vector<std::string> docs(1000, "filler");
+    docs[500] = "rare tail";
+    docs[998] = "rare";
+    docs[999] = "tail tail";
+    InvertedIndex idx;
+    idx.UpdateDocumentBase(docs);
+    SearchServer srv(idx, 5);
+    const std::vector<RelativeIndex> expected_or = {{500, 1.0f}, {999, 1.0f}, {998, 0.5f}};
+    ASSERT_EQ(srv.SearchQuery("rare tail"), expected_or);
+    QueryOptions options;
+    options.limit = 5;
+    options.mode = QueryMode::And;
+    const std::vector<RelativeIndex> expected_and = {{500, 1.0f}};
+    ASSERT_EQ(srv.Search("rare tail", options).items, expected_and);
+    // После запросов с другим диапазоном массив снова нулевой
+    const std::vector<RelativeIndex> expected_filler = {{0, 1.0f}, {1, 1.0f}, {2, 1.0f}, {3, 1.0f}, {4, 1.0f}};
+    ASSERT_EQ(srv.SearchQuery("filler"), expected_filler);
+    ASSERT_EQ(srv.SearchQuery("rare tail"), expected_or);
+}
+
+TEST(TestCaseAnswersWriter, TestBinaryRoundTrip) {
+    std::vector<std::vector<std::pair<int, float>>> answers = {
+        { {2, 1.0f}, {0, 0.7f} },
+        {},
+        { {7, 0.25f} }
+    };
+    auto path = (std::filesystem::temp_directory_path() / "search_engine_answers_test.bin").string();
+    {
+        AnswersBinaryWriter writer(path);
+        for (auto &answer : answers) {
+            writer.Write(answer);
+        }
+        writer.Finish();
+    }
+    ASSERT_EQ(std::filesystem::file_size(path), 16u + 3 * 12u);
+    auto records = BinaryAnswersReader::ReadAll(path);
+    const std::vector<std::vector<AnswerRecord>> expected = {
+        { {0, 2, 1.0f}, {0, 0, 0.7f} },
+        {},
+        { {2, 7, 0.25f} }
+    };
+    ASSERT_EQ(records, expected);
+    std::filesystem::remove(path);
+}
+
+TEST(TestCaseDocumentStore, TestRoundTrip) {
+    // Кодек: повторы сжимаются, случайные байты восстанавливаются без потерь
+    std::string repeated;
+    for (int i = 0; i < 200; i++) {
+        repeated += "milk water sugar " + std::to_string(i % 7) + " ";
+    }
+    std::string compressed = LzCompress(repeated);
+    ASSERT_LT(compressed.size(), repeated.size() / 4);
+    ASSERT_EQ(LzDecompress(compressed, repeated.size()), repeated);
+    std::string noise;
+    std::mt19937 rng(7);
+    for (int i = 0; i < 5000; i++) {
+        noise.push_back(static_cast<char>(rng()));
+    }
+    ASSERT_EQ(LzDecompress(LzCompress(noise), noise.size()), noise);
+    ASSERT_EQ(LzDecompress(LzCompress(""), 0), "");
+    ASSERT_THROW(LzDecompress(compressed, repeated.size() + 1), std::runtime_error);
+
+    // Маленькие блоки: документы пересекают границы блоков
+    std::vector<std::string> docs = {"", "milk water", repeated, "последний документ"};
+    auto path = (std::filesystem::temp_directory_path() / "search_engine_store_test.seds").string();
+    for (DocumentCodec codec : {DocumentCodec::Lz, DocumentCodec::None}) {
+        DocumentStoreOptions options;
+        options.codec = codec;
+        options.block_size = 256;
+        {
+            DocumentStoreWriter writer(path, options);
+            for (auto &doc : docs) {
+                writer.Add(doc);
+            }
+            ASSERT_EQ(writer.Count(), docs.size());
+            writer.Finish();
+        }
+        DocumentStore store(path, 4);
+        ASSERT_EQ(store.Size(), docs.size());
+        ASSERT_EQ(store.RawBytes(), 10 + repeated.size() + docs[3].size());
+        for (size_t i = 0; i < docs.size(); i++) {
+            ASSERT_EQ(store.Get(i), docs[i]);
+        }
+        ASSERT_EQ(store.Prefix(2, 300), repeated.substr(0, 300));
+        ASSERT_GT(store.CacheHits(), 0u);
+        ASSERT_THROW(store.Get(docs.size()), std::out_of_range);
+        if (codec == DocumentCodec::Lz) {
+            ASSERT_LT(store.FileBytes(), store.RawBytes());
+        }
+    }
+
+    // Обрезанный файл не открывается
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    ASSERT_THROW(DocumentStore{path}, std::runtime_error);
+    std::filesystem::remove(path);
+
+    // Запись, прерванная до Finish, не оставляет ни хранилища, ни временного файла
+    {
+        DocumentStoreWriter writer(path, {});
+        writer.Add("ab");
+    }
+    ASSERT_FALSE(std::filesystem::exists(path));
+    ASSERT_FALSE(std::filesystem::exists(path + ".tmp"));
+
+    // Испорченное смещение документа обнаруживается при чтении
+    {
+        DocumentStoreWriter writer(path, {});
+        writer.Add("ab");
+        writer.Add("cd");
+        writer.Finish();
+    }
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        uint64_t tables = 0;
+        file.seekg(static_cast<std::streamoff>(std::filesystem::file_size(path)) - 28 + 16);
+        file.read(reinterpret_cast<char *>(&tables), sizeof(tables));
+        uint64_t broken = 5;
+        file.seekp(static_cast<std::streamoff>(tables + 8));
+        file.write(reinterpret_cast<const char *>(&broken), sizeof(broken));
+    }
+    DocumentStore broken_store(path);
+    ASSERT_THROW(broken_store.Get(0), std::runtime_error);
+    ASSERT_THROW(broken_store.Prefix(1, 10), std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST(TestCaseQueryServer, TestHandleLine) {
+    InvertedIndex idx;
+    idx.UpdateDocumentBase({"milk water", "milk", "water"});
+    SearchServer srv(idx, 5);
+    QueryServer server(srv);
+    auto response = nlohmann::json::parse(server.HandleLine(R"({"query": "milk", "k": 1, "id": 7})"));
+    ASSERT_EQ(response["id"], 7);
+    ASSERT_EQ(response["result"], true);
+    ASSERT_EQ(response["relevance"].size(), 1u);
+    ASSERT_EQ(response["relevance"][0]["docid"], 0);
+    response = nlohmann::json::parse(server.HandleLine(R"({"query": "sugar"})"));
+    ASSERT_EQ(response["result"], false);
+    ASSERT_FALSE(response.contains("relevance"));
+    response = nlohmann::json::parse(server.HandleLine(R"({"id": 3, "k": -1, "query": "milk"})"));
+    ASSERT_EQ(response["id"], 3);
+    ASSERT_TRUE(response.contains("error"));
+    response = nlohmann::json::parse(server.HandleLine(R"({"query": "milk water", "mode": "and"})"));
+    ASSERT_EQ(response["relevance"].size(), 1u);
+    response = nlohmann::json::parse(server.HandleLine(R"({"query": "milk", "mode": "all"})"));
+    ASSERT_TRUE(response.contains("error"));
+    response = nlohmann::json::parse(server.HandleLine("not json"));
+    ASSERT_TRUE(response.contains("error"));
+    // Сообщение об ошибке с некорректным UTF-8 из запроса всё равно сериализуется
+    response = nlohmann::json::parse(server.HandleLine("{\"query\":\"\xff\"}"));
+    ASSERT_TRUE(response.contains("error"));
+
+    // Протокол без аутентификации слушает только локальные адреса
+    ASSERT_TRUE(SocketAddress::Parse("8080").IsLoopback());
+    ASSERT_TRUE(SocketAddress::Parse("localhost:8080").IsLoopback());
+    ASSERT_TRUE(SocketAddress::Parse("127.0.0.2:8080").IsLoopback());
+    ASSERT_TRUE(SocketAddress::Parse("unix:/tmp/search.sock").IsLoopback());
+    ASSERT_FALSE(SocketAddress::Parse("0.0.0.0:8080").IsLoopback());
+    ASSERT_FALSE(SocketAddress::Parse("127.evil.com:8080").IsLoopback());
+    ASSERT_THROW(server.Listen(SocketAddress::Parse("0.0.0.0:0")), std::runtime_error);
+
+    // Путь unix-сокета освобождается, только если там сокет, а не другой файл
+    auto socket_path = (std::filesystem::temp_directory_path() / "search_engine_listen_test").string();
+    auto unix_address = SocketAddress::Parse("unix:" + socket_path);
+    std::ofstream(socket_path) << "data";
+    ASSERT_THROW(ListenSocket(unix_address, 1), std::runtime_error);
+    ASSERT_EQ(ReadFile(socket_path), "data");
+    std::filesystem::remove(socket_path);
+    CloseSocket(ListenSocket(unix_address, 1));
+    CloseSocket(ListenSocket(unix_address, 1)); // старый файл сокета заменяется
+    RemoveUnixSocket(socket_path);
+    ASSERT_FALSE(std::filesystem::exists(socket_path));
+}
+
+TEST(TestCaseQueryServer, TestClientTimeoutIsCapped) {
+    // Запрос из четырёх длинных списков заведомо дольше срока сервера в 1 мс
+    InvertedIndex idx;
+    idx.UpdateDocumentBase(std::vector<std::string>(500000, "common"));
+    SearchServer srv(idx, 5);
+    srv.SetQueryLimits(std::chrono::milliseconds(1), 0);
+    QueryServer server(srv);
+    auto response = nlohmann::json::parse(
+        server.HandleLine(R"({"query": "common common common common", "timeout_ms": 60000})"));
+    ASSERT_EQ(response["partial"], true);
+    // Огромный срок не переполняет время: без срока сервера запрос выполняется целиком
+    srv.SetQueryLimits(std::chrono::milliseconds(0), 0);
+    response = nlohmann::json::parse(
+        server.HandleLine(R"({"query": "common", "timeout_ms": 18446744073709551615})"));
+    ASSERT_FALSE(response.contains("partial"));
+}
+
+#ifndef _WIN32
+TEST(TestCaseQueryServer, TestServesOverTcp) {
+    InvertedIndex idx;
+    idx.UpdateDocumentBase({"milk water", "milk", "water"});
+    SearchServer srv(idx, 5);
+    QueryServerOptions options;
+    options.max_line_length = 64;
+    QueryServer server(srv, options);
+    server.Listen(SocketAddress::Parse("127.0.0.1:0"));
+    std::thread runner([&server]() { server.Run(); });
+
+    SocketAddress address;
+    address.port = server.Port();
+    int fd = ConnectSocket(address);
+    // Два запроса одним пакетом - два ответа по порядку
+    ASSERT_TRUE(WriteAll(fd, "{\"query\": \"water\", \"id\": 1}\n{\"query\": \"milk\", \"id\": 2}\n"));
+    std::string received;
+    char chunk[4096];
+    while (std::count(received.begin(), received.end(), '\n') < 2) {
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        ASSERT_GT(n, 0);
+        received.append(chunk, static_cast<size_t>(n));
+    }
+    std::istringstream lines(received);
+    std::string line;
+    std::getline(lines, line);
+    ASSERT_EQ(line, server.HandleLine(R"({"query": "water", "id": 1})"));
+    std::getline(lines, line);
+    ASSERT_EQ(line, server.HandleLine(R"({"query": "milk", "id": 2})"));
+    CloseSocket(fd);
+
+    // Сервер закрывает соединение сам, не дожидаясь следующего клиента
+    fd = ConnectSocket(address);
+    timeval timeout{5, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ASSERT_TRUE(WriteAll(fd, std::string(100, 'x')));
+    received.clear();
+    ssize_t n;
+    while ((n = ::recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+        received.append(chunk, static_cast<size_t>(n));
+    }
+    ASSERT_EQ(n, 0);
+    ASSERT_EQ(received, "{\"error\":\"request line is too long\"}\n");
+    CloseSocket(fd);
+
+    server.Stop();
+    runner.join();
+}
+#endif
+
+TEST(TestCaseHttpServer, TestUrlDecode) {
+    ASSERT_EQ(HttpServer::UrlDecode("milk+water"), "milk water");
+    ASSERT_EQ(HttpServer::UrlDecode("%D0%BC%D0%BE%D0%BB%D0%BE%D0%BA%D0%BE"), "молоко");
+    ASSERT_EQ(HttpServer::UrlDecode("100%"), "100%");
+    ASSERT_EQ(HttpServer::UrlDecode("%zz"), "%zz");
+}
+
+#ifdef __linux__
+TEST(TestCaseHttpServer, TestPipelinedKeepAlive) {
+    InvertedIndex idx;
+    idx.UpdateDocumentBase({"milk water", "milk", "water"});
+    SearchServer srv(idx, 5);
+    HttpServerOptions options;
+    options.scheduler.threads = 2;
+    HttpServer server(srv, options);
+    server.Listen(SocketAddress::Parse("127.0.0.1:0"));
+    std::thread runner([&server]() { server.Run(); });
+
+    SocketAddress address;
+    address.port = server.Port();
+    int fd = ConnectSocket(address);
+    // Три запроса одним пакетом; последний просит закрыть соединение
+    ASSERT_TRUE(WriteAll(fd, "GET /search?q=water&k=1 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                             "GET /search?q=sugar HTTP/1.1\r\n\r\n"
+                             "GET /search?q=%FF&explain=1 HTTP/1.1\r\n\r\n"
+                             "GET /other HTTP/1.1\r\nConnection: close\r\n\r\n"));
+    std::string received;
+    char chunk[4096];
+    for (ssize_t n; (n = ::recv(fd, chunk, sizeof(chunk), 0)) > 0;) {
+        received.append(chunk, static_cast<size_t>(n));
+    }
+    CloseSocket(fd);
+    server.Stop();
+    runner.join();
+
+    std::vector<std::string> bodies;
+    std::vector<std::string> statuses;
+    for (size_t pos = 0; pos < received.size();) {
+        size_t head_end = received.find("\r\n\r\n", pos);
+        ASSERT_NE(head_end, std::string::npos);
+        std::string head = received.substr(pos, head_end - pos);
+        statuses.push_back(head.substr(0, head.find("\r\n")));
+        size_t length_pos = head.find("Content-Length: ");
+        ASSERT_NE(length_pos, std::string::npos);
+        size_t length = std::stoul(head.substr(length_pos + 16));
+        bodies.push_back(received.substr(head_end + 4, length));
+        pos = head_end + 4 + length;
+    }
+    ASSERT_EQ(statuses, std::vector<std::string>({"HTTP/1.1 200 OK", "HTTP/1.1 200 OK", "HTTP/1.1 200 OK",
+                                                  "HTTP/1.1 404 Not Found"}));
+    ASSERT_EQ(nlohmann::json::parse(bodies[0]),
+              nlohmann::json::parse(R"({"result": true, "relevance": [{"docid": 0, "rank": 1.0}]})"));
+    ASSERT_EQ(nlohmann::json::parse(bodies[1]), nlohmann::json::parse(R"({"result": false})"));
+    // Некорректный UTF-8 из запроса попадает в трассировку заменённым
+    ASSERT_EQ(nlohmann::json::parse(bodies[2])["explain"]["terms"][0]["term"], "\xEF\xBF\xBD");
+}
+#endif
+
+TEST(TestCaseSearchServer, TestQueryBudgetAndDeadline) {
+    // "common" есть во всех документах, "rare" - только в двух
+    std::vector<std::string> docs;
+    for (int i = 0; i < 100; i++) {
+        docs.push_back(i % 50 == 7 ? "common rare rare" : "common");
+    }
+    InvertedIndex idx;
+    idx.UpdateDocumentBase(docs);
+    SearchServer srv(idx, 5);
+
+    QueryOptions options;
+    options.limit = 5;
+    QueryResult full = srv.Search("common rare", options);
+    ASSERT_FALSE(full.partial);
+    ASSERT_EQ(full.postings_scored, 102u);
+    ASSERT_EQ(full.items, srv.SearchQuery("common rare"));
+
+    // Бюджет тратится сначала на редкий термин
+    options.max_postings = 10;
+    QueryResult budgeted = srv.Search("common rare", options);
+    ASSERT_TRUE(budgeted.partial);
+    ASSERT_EQ(budgeted.postings_scored, 10u);
+    ASSERT_EQ(budgeted.items[0].doc_id, 7u);
+    ASSERT_EQ(budgeted.items[1].doc_id, 57u);
+
+    // Истёкший срок: результат пустой и помечен как неполный
+    options.max_postings = 0;
+    options.deadline = std::chrono::steady_clock::now();
+    QueryResult expired = srv.Search("milk common", options);
+    ASSERT_TRUE(expired.partial);
+    ASSERT_TRUE(expired.items.empty());
+}
+
+TEST(TestCaseSearchServer, TestExplain) {
+    std::vector<std::string> docs;
+    for (int i = 0; i < 10000; i++) {
+        docs.push_back(i % 5000 == 7 ? "common rare rare" : "common");
+    }
+    InvertedIndex idx;
+    idx.UpdateDocumentBase(docs);
+    SearchServer srv(idx, 2);
+
+    QueryOptions options;
+    options.limit = 2;
+    options.explain = true;
+    options.max_postings = 5000;
+    QueryResult result = srv.Search("Common milk rare", options);
+    ASSERT_TRUE(result.partial);
+    ASSERT_TRUE(result.explain);
+    const QueryExplain &explain = *result.explain;
+    // Слова - в порядке запроса
+    ASSERT_EQ(explain.terms.size(), 3u);
+    ASSERT_EQ(explain.terms[0].term, "common");
+    ASSERT_EQ(explain.terms[0].posting_length, 10000u);
+    ASSERT_EQ(explain.terms[0].postings_scored, 4998u);
+    ASSERT_EQ(explain.terms[0].bytes_decoded, 4998u * 8);
+    ASSERT_EQ(explain.terms[0].blocks_scanned, 2u);
+    ASSERT_EQ(explain.terms[0].blocks_skipped, 1u);
+    ASSERT_EQ(explain.terms[1].posting_length, 0u);
+    ASSERT_EQ(explain.terms[2].postings_scored, 2u);
+    // Порог top-2 после редкого слова и после частого
+    ASSERT_EQ(explain.thresholds.size(), 2u);
+    ASSERT_EQ(explain.thresholds[0].term, 2u);
+    ASSERT_EQ(explain.thresholds[0].candidates, 2u);
+    ASSERT_EQ(explain.thresholds[0].threshold, 2u);
+    ASSERT_EQ(explain.thresholds[1].term, 0u);
+    // Документ 5007 - кандидат только по редкому слову: частое до него не дошло
+    ASSERT_EQ(explain.thresholds[1].candidates, 4999u);
+    ASSERT_EQ(explain.thresholds[1].threshold, 2u);
+    ASSERT_GT(explain.total_time.count(), 0);
+
+    auto json = ExplainToJson(explain);
+    ASSERT_EQ(json["terms"][2]["term"], "rare");
+    ASSERT_EQ(json["thresholds"][1]["term"], "common");
+
+    // Без explain трассировки нет
+    options.max_postings = 0;
+    options.explain = false;
+    ASSERT_FALSE(srv.Search("rare", options).explain);
+    options.explain = true;
+    ASSERT_TRUE(srv.Search("rare", options).explain);
+    ASSERT_EQ(result.items[0].doc_id, 7u);
+}
+
+TEST(TestCaseSearchServer, TestPhraseQueries) {
+    std::vector<std::string> docs = {
+        "great Britain is an island",
+        "britain great",
+        "great old britain great britain",
+        "great wide green britain",
+    };
+    // Больше PositionList::kSkipInterval вхождений: чтение идёт через таблицу пропусков
+    std::vector<size_t> expected_phrase = {0, 2};
+    for (size_t i = 4; i < 300; i++) {
+        docs.push_back(i % 3 == 0 ? "x great britain" : "great x britain x");
+        if (i % 3 == 0) {
+            expected_phrase.push_back(i);
+        }
+    }
+    auto doc_ids = [](const std::vector<RelativeIndex> &items) {
+        std::vector<size_t> ids;
+        for (const auto &item : items) {
+            ids.push_back(item.doc_id);
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+
+    IndexOptions options;
+    options.positions = true;
+    InvertedIndex idx(options);
+    idx.UpdateDocumentBase(docs);
+    ASSERT_TRUE(idx.HasPositions());
+    ASSERT_EQ(idx.GetPositions("great").postings, docs.size());
+    ASSERT_GT(idx.GetMemoryReport().position_payload, 0u);
+    SearchServer srv(idx, 1000);
+
+    ASSERT_EQ(doc_ids(srv.SearchQuery("\"great britain\"")), expected_phrase);
+    ASSERT_EQ(doc_ids(srv.SearchQuery("\"Great BRITAIN")), expected_phrase); // незакрытая кавычка
+    ASSERT_EQ(doc_ids(srv.SearchQuery("\"britain great\"")), (std::vector<size_t>{1, 2}));
+    ASSERT_TRUE(srv.SearchQuery("\"island great\"").empty());
+    // До k посторонних слов между соседними словами фразы
+    auto slop1 = srv.SearchQuery("\"great britain\"~1");
+    ASSERT_EQ(slop1[0].doc_id, 2u); // два совпадения: great old britain и great britain
+    ASSERT_FLOAT_EQ(slop1[1].rank, 0.5f);
+    ASSERT_EQ(slop1.size(), docs.size() - 2); // все, кроме "britain great" и "great wide green britain"
+    auto slop2 = doc_ids(srv.SearchQuery("\"great britain\"~2"));
+    ASSERT_TRUE(std::binary_search(slop2.begin(), slop2.end(), 3u));
+    // Фраза и отдельное слово складываются, как два слова
+    auto mixed = srv.SearchQuery("island \"great britain\"");
+    ASSERT_EQ(mixed[0].doc_id, 0u);
+    ASSERT_FLOAT_EQ(mixed[0].rank, 1.0f);
+    // Фраза и те же слова без кавычек - разные запросы
+    ASSERT_EQ(srv.SearchQuery("great britain").size(), docs.size());
+    ASSERT_EQ(srv.SearchQuery("\"great britain\"").size(), expected_phrase.size());
+    ASSERT_EQ(srv.EstimateCost("\"great britain\""), 2 * docs.size());
+
+    QueryOptions explain_options;
+    explain_options.limit = 5;
+    explain_options.explain = true;
+    auto explained = srv.Search("x \"Great britain\"~1", explain_options);
+    ASSERT_EQ(explained.explain->terms[1].term, "\"great britain\"~1");
+    ASSERT_EQ(explained.explain->terms[1].posting_length, slop1.size());
+    ASSERT_GT(explained.explain->terms[1].position_bytes, 0u);
+    ASSERT_EQ(explained.explain->terms[0].position_bytes, 0u);
+
+    // Бюджет кончился на поиске фразы: в выдаче совпадения, найденные до остановки,
+    // а список слова после фразы уже не читается
+    QueryOptions budget_options;
+    budget_options.limit = 1000;
+    budget_options.max_postings = 3;
+    auto cut = srv.Search("\"great britain\" x", budget_options);
+    ASSERT_TRUE(cut.partial);
+    ASSERT_EQ(cut.postings_scored, 3u);
+    ASSERT_EQ(doc_ids(cut.items), (std::vector<size_t>{0, 2}));
+    budget_options.mode = QueryMode::And;
+    ASSERT_TRUE(srv.Search("\"great britain\" great", budget_options).partial);
+    budget_options.max_postings = 0;
+    budget_options.deadline = std::chrono::steady_clock::now();
+    auto expired = srv.Search("\"great britain\"", budget_options);
+    ASSERT_TRUE(expired.partial);
+    ASSERT_TRUE(expired.items.empty());
+
+    // Без позиционного индекса фраза требует только всех слов в документе
+    InvertedIndex plain;
+    plain.UpdateDocumentBase(docs);
+    ASSERT_FALSE(plain.HasPositions());
+    ASSERT_TRUE(plain.GetPositions("great").empty());
+    SearchServer plain_srv(plain, 1000);
+    ASSERT_EQ(plain_srv.SearchQuery("\"britain great\"").size(), docs.size());
+
+    // Позиции строятся только при индексации из строк
+    InvertedIndex from_files(options);
+    ASSERT_THROW(from_files.UpdateDocumentBaseFromFiles({}), std::logic_error);
+}
+
+TEST(TestCaseSearchServer, TestAndMode) {
+    const uint32_t ids[] = {2, 4, 8, 16, 32, 64, 128, 256, 512};
+    ASSERT_EQ(GallopLowerBound(ids, 9, 0, 1), 0u);
+    ASSERT_EQ(GallopLowerBound(ids, 9, 0, 100), 6u);
+    ASSERT_EQ(GallopLowerBound(ids, 9, 3, 16), 3u);
+    ASSERT_EQ(GallopLowerBound(ids, 9, 4, 512), 8u);
+    ASSERT_EQ(GallopLowerBound(ids, 9, 2, 1000), 9u);
+
+    std::vector<std::string> docs;
+    for (int i = 0; i < 10000; i++) {
+        docs.push_back(std::string("common") + (i % 2 == 0 ? " mid" : "") + (i % 1000 == 0 ? " rare rare" : ""));
+    }
+    InvertedIndex idx;
+    idx.UpdateDocumentBase(docs);
+    SearchServer srv(idx, 100);
+
+    QueryOptions options;
+    options.limit = 100;
+    options.mode = QueryMode::And;
+    QueryResult result = srv.Search("common mid rare", options);
+    ASSERT_EQ(result.items.size(), 10u);
+    for (size_t i = 0; i < result.items.size(); i++) {
+        ASSERT_EQ(result.items[i].doc_id, i * 1000);
+        ASSERT_FLOAT_EQ(result.items[i].rank, 1.0f);
+    }
+    // Просмотрен только список самого редкого слова
+    ASSERT_EQ(result.postings_scored, 10u);
+    ASSERT_EQ(srv.EstimateCost("common mid rare", QueryMode::And), 30u);
+    ASSERT_EQ(srv.EstimateCost("common mid rare"), 15010u);
+    // Слова нет в индексе - пересечение пусто без чтения списков
+    result = srv.Search("common milk", options);
+    ASSERT_TRUE(result.items.empty());
+    ASSERT_EQ(result.postings_scored, 0u);
+    // Режим задаётся для каждого запроса
+    ASSERT_EQ(srv.Search("common rare", options).items.size(), 10u);
+    options.mode = QueryMode::Or;
+    ASSERT_EQ(srv.Search("common rare", options).items.size(), 100u);
+    options.mode = QueryMode::And;
+    // Фраза - ещё один список пересечения
+    ASSERT_EQ(srv.Search("\"common mid\" rare", options).items.size(), 10u);
+
+    // Бюджет расходуется на короткий список
+    options.max_postings = 4;
+    result = srv.Search("mid rare", options);
+    ASSERT_TRUE(result.partial);
+    ASSERT_EQ(result.items.size(), 4u);
+
+    options.max_postings = 0;
+    options.explain = true;
+    result = srv.Search("common rare", options);
+    const QueryExplain &explain = *result.explain;
+    ASSERT_EQ(explain.terms[1].postings_scored, 10u);
+    ASSERT_EQ(explain.terms[1].blocks_scanned, 1u);
+    ASSERT_EQ(explain.terms[0].postings_scored, 10u);
+    ASSERT_EQ(explain.terms[0].blocks_scanned, 0u);
+    ASSERT_EQ(explain.thresholds.size(), 1u);
+    ASSERT_EQ(explain.thresholds[0].term, 1u);
+    ASSERT_EQ(explain.thresholds[0].candidates, 10u);
+
+    // Режим по умолчанию задаётся серверу
+    srv.SetQueryMode(QueryMode::And);
+    ASSERT_EQ(srv.SearchQuery("mid rare").size(), 10u);
+}
+
+TEST(TestCaseQueryScheduler, TestPriorityAndRejection) {
+    InvertedIndex idx;
+    idx.UpdateDocumentBase({"milk water", "milk", "water milk milk"});
+    SearchServer srv(idx, 5);
+    ASSERT_EQ(srv.EstimateCost("milk water sugar"), 5u);
+
+    SchedulerOptions options;
+    options.threads = 1;
+    options.queue_capacity = 1;
+    options.max_queued_cost = 4;
+    QueryScheduler scheduler(srv, options);
+
+    // Первый запрос занимает единственный поток, пока не откроем gate
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::mutex mtx;
+    std::vector<std::string> order;
+    auto record = [&mtx, &order](const std::string &name) {
+        return [&mtx, &order, name](QueryResult &&) {
+            std::lock_guard<std::mutex> lock(mtx);
+            order.push_back(name);
+        };
+    };
+    std::promise<void> started;
+    ASSERT_TRUE(scheduler.Submit("milk", QueryOptions(), QueryPriority::Interactive,
+                                 [&started, opened](QueryResult &&) {
+        started.set_value();
+        opened.wait();
+    }));
+    started.get_future().wait();
+
+    ASSERT_TRUE(scheduler.Submit("water", QueryOptions(), QueryPriority::Batch, record("batch")));
+    ASSERT_TRUE(scheduler.Submit("water", QueryOptions(), QueryPriority::Interactive, record("interactive")));
+    // Очередь интерактивного класса заполнена
+    ASSERT_FALSE(scheduler.Submit("water", QueryOptions(), QueryPriority::Interactive, record("rejected")));
+    // В очередях уже 4 вхождения: ещё 3 превысили бы max_queued_cost
+    ASSERT_FALSE(scheduler.Submit("milk", QueryOptions(), QueryPriority::Batch, record("rejected")));
+
+    gate.set_value();
+    scheduler.Shutdown();
+    ASSERT_EQ(order, std::vector<std::string>({"interactive", "batch"}));
+    SchedulerStats stats = scheduler.Stats();
+    ASSERT_EQ(stats.accepted, 3u);
+    ASSERT_EQ(stats.rejected, 2u);
+    ASSERT_EQ(stats.completed, 3u);
+}
+
+TEST(TestCaseQueryScheduler, TestShutdownWithQueuedBatch) {
+    InvertedIndex idx;
+    idx.UpdateDocumentBase({"milk water", "milk"});
+    SearchServer srv(idx, 5);
+    SchedulerOptions options;
+    options.threads = 4;
+    options.batch_threads = 1;
+    // В куче: если Shutdown зависнет, тест упадёт, а не повиснет в деструкторе
+    auto *scheduler = new QueryScheduler(srv, options);
+
+    // Первое пакетное задание держит единственный пакетный слот, остальные
+    // потоки засыпают при непустой пакетной очереди
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::atomic<size_t> done{0};
+    for (int i = 0; i < 6; i++) {
+        ASSERT_TRUE(scheduler->Submit("milk", QueryOptions(), QueryPriority::Batch,
+                                      [&done, opened, i](QueryResult &&) {
+            opened.wait();
+            // Разбуженные потоки успевают снова уснуть до освобождения слота
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            done++;
+            if (i == 0) {
+                // Исключение обработчика ответа не останавливает поток планировщика
+                throw std::runtime_error("callback failed");
+            }
+        }));
+    }
+    std::promise<void> stopped;
+    auto stopped_future = stopped.get_future();
+    std::thread stopper([scheduler, &stopped]() {
+        scheduler->Shutdown();
+        stopped.set_value();
+    });
+    // Ворота открываются только после начала остановки: Submit тогда отклоняет запросы
+    while (scheduler->Submit("milk", QueryOptions(), QueryPriority::Interactive, [](QueryResult &&) {})) {
+        std::this_thread::yield();
+    }
+    gate.set_value();
+    if (stopped_future.wait_for(std::chrono::seconds(10)) != std::future_status::ready) {
+        stopper.detach();
+        FAIL() << "Shutdown did not return";
+    }
+    stopper.join();
+    ASSERT_EQ(done.load(), 6u);
+    delete scheduler;
+}
+
+TEST(TestCaseCorpusGenerator, TestDeterministicCorpus) {
+    CorpusOptions options;
+    options.seed = 7;
+    options.vocabulary = 1000;
+    options.doc_length_mean = 50;
+    options.query_repeat_rate = 0.5;
+    CorpusGenerator generator(options);
+    CorpusGenerator same(options);
+    options.seed = 8;
+    CorpusGenerator other(options);
+    ASSERT_EQ(generator.Document(3), same.Document(3));
+    ASSERT_NE(generator.Document(3), other.Document(3));
+    ASSERT_EQ(generator.Queries(100), same.Queries(100));
+
+    // Частые слова короче редких; в словаре есть и кириллица, и латиница
+    auto letters = [](const std::string &word) {
+        return std::count_if(word.begin(), word.end(), [](char c) { return (c & 0xC0) != 0x80; });
+    };
+    ASSERT_LT(letters(generator.Word(0)), letters(generator.Word(999)));
+    size_t cyrillic = 0;
+    for (size_t rank = 0; rank < generator.VocabularySize(); rank++) {
+        cyrillic += static_cast<unsigned char>(generator.Word(rank)[0]) >= 0x80;
+    }
+    ASSERT_GT(cyrillic, 300u);
+    ASSERT_LT(cyrillic, 700u);
+
+    auto queries = generator.Queries(1000);
+    std::sort(queries.begin(), queries.end());
+    size_t unique = std::unique(queries.begin(), queries.end()) - queries.begin();
+    ASSERT_LT(unique, 700u);
+
+    // Записанный корпус читается программой
+    auto dir = (std::filesystem::temp_directory_path() / "search_engine_corpus_test").string();
+    WriteCorpus(dir, generator, 20, 5, 2);
+    Config config = Config::Load(dir + "/config.json");
+    ASSERT_EQ(config.files.size(), 20u);
+    ASSERT_EQ(ReadFile(dir + "/" + config.files[12]), generator.Document(12));
+    std::ifstream requests(dir + "/requests.json");
+    ASSERT_EQ(nlohmann::json::parse(requests)["requests"].size(), 5u);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(TestCaseLatencyHistogram, TestPercentiles) {
+    LatencyHistogram histogram;
+    for (uint64_t v = 1; v <= 100000; v++) {
+        histogram.Record(v * 1000);
+    }
+    ASSERT_EQ(histogram.Count(), 100000u);
+    ASSERT_EQ(histogram.Min(), 1000u);
+    ASSERT_EQ(histogram.Max(), 100000000u);
+    // Относительная погрешность корзин не больше 1/64
+    for (double p : {50.0, 99.0, 99.9}) {
+        double expected = p * 1000 * 1000;
+        ASSERT_NEAR(static_cast<double>(histogram.ValueAtPercentile(p)), expected, expected / 64);
+    }
+    ASSERT_EQ(histogram.ValueAtPercentile(100), histogram.Max());
+    // Малые значения хранятся точно
+    LatencyHistogram small;
+    small.Record(3);
+    small.Record(100);
+    ASSERT_EQ(small.ValueAtPercentile(50), 3u);
+    ASSERT_EQ(small.ValueAtPercentile(100), 100u);
+
+    // Поправка: замер 10 мс при ожидаемом интервале 1 мс добавляет 9 значений
+    LatencyHistogram corrected;
+    corrected.RecordCorrected(10000000, 1000000);
+    ASSERT_EQ(corrected.Count(), 10u);
+    ASSERT_EQ(corrected.Min(), 1000000u);
+    histogram.Merge(corrected);
+    ASSERT_EQ(histogram.Count(), 100010u);
+}
+
+TEST(TestCaseLoadGenerator, TestClosedAndOpenLoop) {
+    InvertedIndex idx;
+    idx.UpdateDocumentBase({"milk water", "milk", "water"});
+    SearchServer srv(idx, 5);
+    auto factory = [&srv]() { return std::make_unique<InProcessLoadClient>(srv); };
+    LoadOptions options;
+    options.concurrency = 2;
+    options.duration = std::chrono::milliseconds(50);
+    LoadReport closed = RunLoad({"milk", "water sugar"}, factory, options);
+    ASSERT_GT(closed.requests, 0u);
+    ASSERT_EQ(closed.errors, 0u);
+    ASSERT_EQ(closed.latency.Count(), closed.requests);
+
+    // Открытый цикл отправляет ровно qps * duration запросов
+    options.mode = LoadMode::OpenLoop;
+    options.qps = 1000;
+    options.duration = std::chrono::milliseconds(100);
+    LoadReport open = RunLoad({"milk"}, factory, options);
+    ASSERT_EQ(open.requests, 100u);
+}
+
+TEST(TestCaseMetrics, TestRegistryAndExport) {
+    MetricsRegistry registry;
+    Counter &counter = registry.GetCounter("test_events_total", "Events");
+    ASSERT_EQ(&counter, &registry.GetCounter("test_events_total", "Events"));
+    ASSERT_THROW(registry.GetGauge("test_events_total", "Events"), std::logic_error);
+    // Шарды потоков суммируются при чтении
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&counter]() {
+            for (int i = 0; i < 1000; i++) {
+                counter.Add();
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(counter.Value(), 4000u);
+
+    registry.GetGauge("test_terms", "Terms").Set(42);
+    Histogram &latency = registry.GetHistogram("test_latency_seconds", "Latency", 1e9);
+    for (uint64_t v = 1; v <= 100; v++) {
+        latency.Record(v * 1000000);
+    }
+    auto snapshot = latency.Collect();
+    ASSERT_EQ(snapshot.count, 100u);
+    ASSERT_NEAR(static_cast<double>(snapshot.ValueAtPercentile(50)), 50e6, 50e6 / 16);
+
+    std::string text = registry.DumpPrometheus();
+    ASSERT_NE(text.find("# TYPE test_events_total counter\ntest_events_total 4000\n"), std::string::npos);
+    ASSERT_NE(text.find("test_terms 42\n"), std::string::npos);
+    ASSERT_NE(text.find("test_latency_seconds_bucket{le=\"+Inf\"} 100\n"), std::string::npos);
+    ASSERT_NE(text.find("test_latency_seconds_count 100\n"), std::string::npos);
+    auto json = nlohmann::json::parse(registry.DumpJson());
+    ASSERT_EQ(json["test_events_total"], 4000);
+    ASSERT_NEAR(json["test_latency_seconds"]["sum"].get<double>(), 5.05, 1e-9);
+
+    // Поиск пишет в общий реестр
+    Counter &queries = Metrics().GetCounter("search_engine_queries_total", "");
+    uint64_t before = queries.Value();
+    InvertedIndex idx;
+    idx.UpdateDocumentBase({"milk water", "milk"});
+    SearchServer srv(idx, 5);
+    srv.SearchQuery("milk");
+    ASSERT_EQ(queries.Value(), before + 1);
+    ASSERT_NE(Metrics().DumpPrometheus().find("search_engine_index_terms 2\n"), std::string::npos);
+}
+
 // Точка входа для тестов
 int main(int argc, char** argv)
 {
@@ -0,0 +1,90 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include "corpus_generator.h"
+
+/**
+ * Генератор синтетического корпуса для нагрузочного тестирования.
+ * Пример: search_engine_corpus --out corpus_1m --docs 1000000 --queries 10000 --seed 7
+ * Затем search_engine запускается из каталога corpus_1m.
+ */
+
+namespace {
+
+void PrintUsage() {
+    std::cerr << "Usage: search_engine_corpus --out <dir> [options]\n"
+              << "  --docs N               documents (default 1000)\n"
+              << "  --queries N            queries in requests.json (default 1000)\n"
+              << "  --seed N               random seed (default 1)\n"
+              << "  --vocab N              vocabulary size (default 50000)\n"
+              << "  --zipf X               Zipf exponent of word frequencies (default 1.0)\n"
+              << "  --cyrillic X           share of Cyrillic words (default 0.5)\n"
+              << "  --capitalized X        share of capitalized occurrences (default 0.1)\n"
+              << "  --doc-length X         mean document length in words (default 200)\n"
+              << "  --doc-length-sigma X   log-normal sigma of document length (default 0.8)\n"
+              << "  --query-terms X        mean words per query (default 2.5)\n"
+              << "  --repeat-rate X        share of repeated queries (default 0.3)\n"
+              << "  --threads N            writer threads (default: all cores)" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    CorpusOptions options;
+    std::string out;
+    size_t documents = 1000;
+    size_t queries = 1000;
+    size_t threads = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintUsage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--out") {
+            out = value;
+        } else if (arg == "--docs") {
+            documents = std::stoull(value);
+        } else if (arg == "--queries") {
+            queries = std::stoull(value);
+        } else if (arg == "--seed") {
+            options.seed = std::stoull(value);
+        } else if (arg == "--vocab") {
+            options.vocabulary = std::stoull(value);
+        } else if (arg == "--zipf") {
+            options.zipf_exponent = std::stod(value);
+        } else if (arg == "--cyrillic") {
+            options.cyrillic_share = std::stod(value);
+        } else if (arg == "--capitalized") {
+            options.capitalized_share = std::stod(value);
+        } else if (arg == "--doc-length") {
+            options.doc_length_mean = std::stod(value);
+        } else if (arg == "--doc-length-sigma") {
+            options.doc_length_sigma = std::stod(value);
+        } else if (arg == "--query-terms") {
+            options.query_terms_mean = std::stod(value);
+        } else if (arg == "--repeat-rate") {
+            options.query_repeat_rate = std::stod(value);
+        } else if (arg == "--threads") {
+            threads = std::stoull(value);
+        } else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (out.empty()) {
+        PrintUsage();
+        return 2;
+    }
+
+    try {
+        CorpusGenerator generator(options);
+        WriteCorpus(out, generator, documents, queries, threads);
+        std::cout << "Wrote " << documents << " documents and " << queries << " queries to " << out << std::endl;
+    } catch (const std::exception &ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
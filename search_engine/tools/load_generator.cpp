@@ -0,0 +1,143 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "config.h"
+#include "converter_json.h"
+#include "inverted_index.h"
+#include "search_server.h"
+#include "load_generator.h"
+
+/**
+ * Нагрузочный тест поиска.
+ *   search_engine_load --mode open --qps 2000 --duration 30
+ *       индекс строится в процессе по config.json текущего каталога;
+ *   search_engine_load --mode closed --concurrency 32 --connect 127.0.0.1:8080
+ *       нагрузка на запущенный search_engine --serve.
+ * Запросы берутся из requests.json (или --requests <файл>).
+ */
+
+namespace {
+
+void PrintUsage() {
+    std::cerr << "Usage: search_engine_load [options]\n"
+              << "  --mode open|closed       open loop (fixed QPS) or closed loop (default closed)\n"
+              << "  --qps N                  target rate for open loop (default 100)\n"
+              << "  --concurrency N          clients / max requests in flight (default 8)\n"
+              << "  --duration S             test duration in seconds (default 10)\n"
+              << "  --expected-interval-us N closed loop coordinated omission correction\n"
+              << "  --connect ADDR           query server address; in-process search if omitted\n"
+              << "  --requests FILE          queries (default requests.json)\n"
+              << "  --json FILE              write the report as JSON" << std::endl;
+}
+
+double Micros(uint64_t ns) {
+    return static_cast<double>(ns) / 1000.0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    LoadOptions options;
+    std::string connect;
+    std::string requests_path = "requests.json";
+    std::string json_path;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintUsage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--mode" && (value == "open" || value == "closed")) {
+            options.mode = value == "open" ? LoadMode::OpenLoop : LoadMode::ClosedLoop;
+        } else if (arg == "--qps") {
+            options.qps = std::stod(value);
+        } else if (arg == "--concurrency") {
+            options.concurrency = std::stoull(value);
+        } else if (arg == "--duration") {
+            options.duration = std::chrono::milliseconds(static_cast<int64_t>(std::stod(value) * 1000));
+        } else if (arg == "--expected-interval-us") {
+            options.expected_interval_ns = std::stoull(value) * 1000;
+        } else if (arg == "--connect") {
+            connect = value;
+        } else if (arg == "--requests") {
+            requests_path = value;
+        } else if (arg == "--json") {
+            json_path = value;
+        } else {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    try {
+        std::vector<std::string> queries;
+        std::ifstream requests(requests_path);
+        if (!requests) {
+            throw std::runtime_error("cannot open " + requests_path);
+        }
+        ConverterJSON().StreamRequests(requests, [&queries](std::string &&query) {
+            queries.push_back(std::move(query));
+        });
+
+        LoadReport report;
+        if (connect.empty()) {
+            Config config = Config::Load();
+            ConverterJSON converter(config);
+            IndexOptions index_options;
+            index_options.threads = config.threads;
+            index_options.count_width = config.count_width;
+            InvertedIndex idx(index_options);
+            idx.UpdateDocumentBase(converter.GetTextDocuments());
+            SearchServer srv(idx, static_cast<size_t>(config.max_responses));
+            srv.SetQueryLimits(std::chrono::milliseconds(config.query_timeout_ms), config.query_max_postings);
+            report = RunLoad(queries, [&srv]() { return std::make_unique<InProcessLoadClient>(srv); }, options);
+        } else {
+            SocketAddress address = SocketAddress::Parse(connect);
+            report = RunLoad(queries, [&address]() { return std::make_unique<SocketLoadClient>(address); }, options);
+        }
+
+        const double percentiles[] = {50, 75, 90, 95, 99, 99.9, 99.99, 100};
+        std::cout << "requests:   " << report.requests << " (" << report.errors << " errors)\n"
+                  << "duration:   " << report.seconds << " s\n"
+                  << "throughput: " << report.Throughput() << " req/s\n"
+                  << "latency, us: min " << Micros(report.latency.Min())
+                  << ", mean " << report.latency.Mean() / 1000.0 << "\n";
+        std::cout << "  percentile      value_us\n";
+        for (double p : percentiles) {
+            std::cout << "  " << p << "\t" << Micros(report.latency.ValueAtPercentile(p)) << "\n";
+        }
+        std::cout.flush();
+
+        if (!json_path.empty()) {
+            nlohmann::json out;
+            out["mode"] = options.mode == LoadMode::OpenLoop ? "open" : "closed";
+            out["target_qps"] = options.mode == LoadMode::OpenLoop ? options.qps : 0.0;
+            out["concurrency"] = options.concurrency;
+            out["requests"] = report.requests;
+            out["errors"] = report.errors;
+            out["seconds"] = report.seconds;
+            out["throughput"] = report.Throughput();
+            out["latency_us"] = {
+                {"min", Micros(report.latency.Min())},
+                {"mean", report.latency.Mean() / 1000.0},
+                {"p50", Micros(report.latency.ValueAtPercentile(50))},
+                {"p99", Micros(report.latency.ValueAtPercentile(99))},
+                {"p999", Micros(report.latency.ValueAtPercentile(99.9))},
+                {"max", Micros(report.latency.Max())}
+            };
+            nlohmann::json distribution = nlohmann::json::array();
+            for (double p : percentiles) {
+                distribution.push_back({{"percentile", p}, {"value_us", Micros(report.latency.ValueAtPercentile(p))}});
+            }
+            out["distribution"] = distribution;
+            std::ofstream(json_path) << out.dump(4) << std::endl;
+        }
+    } catch (const std::exception &ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}